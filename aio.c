@@ -0,0 +1,151 @@
+#include "aio.h"
+#include "fs.h"
+#include "uart.h"
+#include "thread.h"
+#include "string.h"
+#include <stddef.h>
+
+enum { AIO_FREE = 0, AIO_QUEUED, AIO_DONE };
+enum { AIO_FS_READ, AIO_FS_WRITE, AIO_UART_WRITE };
+
+typedef struct {
+    int state;   /* AIO_* */
+    int op;
+    unsigned int gen; /* bumped per use so a stale handle never matches */
+    char name[FS_NAME_LEN];
+    void *buf;
+    int len;
+    int result;
+    aio_cb cb;
+    void *arg;
+} aio_req;
+
+static aio_req reqs[AIO_MAX];
+/* FIFO of request indices waiting for the worker */
+static int queue[AIO_MAX];
+static unsigned int qhead, qtail;
+static tid_t worker; /* 0 = not running; it is started on demand */
+
+static aio_t handle_of(int idx) {
+    return (aio_t)((reqs[idx].gen % 0x100000) * AIO_MAX + idx);
+}
+
+static aio_req *req_of(aio_t h) {
+    if (h < 0) return NULL;
+    aio_req *r = &reqs[h % AIO_MAX];
+    if (r->state == AIO_FREE || handle_of(h % AIO_MAX) != h) return NULL;
+    return r;
+}
+
+static void run_req(aio_req *r) {
+    switch (r->op) {
+    case AIO_FS_READ:
+        r->result = fs_read_buf(r->name, r->buf, r->len);
+        break;
+    case AIO_FS_WRITE:
+        r->result = fs_write_buf(r->name, r->buf, r->len);
+        break;
+    case AIO_UART_WRITE:
+        for (int i = 0; i < r->len; ++i) uart_putc(((const char *)r->buf)[i]);
+        r->result = r->len;
+        break;
+    }
+}
+
+/* runs while there is work, one batch per turn, and exits when idle so it
+   only holds a thread slot while I/O is pending */
+static int aio_worker(void *unused) {
+    (void)unused;
+    while (qhead != qtail) {
+        for (int n = 0; n < AIO_BATCH && qhead != qtail; ++n) {
+            int idx = queue[qhead++ % AIO_MAX];
+            aio_req *r = &reqs[idx];
+            run_req(r);
+            r->state = AIO_DONE;
+            if (r->cb) {
+                r->cb(handle_of(idx), r->result, r->arg);
+                r->state = AIO_FREE;
+            }
+        }
+        thread_wake(reqs);
+        thread_yield();
+    }
+    worker = 0;
+    return 0;
+}
+
+/* start the worker unless it is running (it may also have been killed) */
+static int ensure_worker(void) {
+    if (worker && thread_exists(worker)) return 0;
+    /* I/O completions are latency-sensitive */
+    worker = thread_spawn_prio(aio_worker, NULL, "aio", THREAD_PRIO_DEFAULT + 1);
+    if (worker < 0) {
+        worker = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static aio_t submit(int op, const char *name, void *buf, int len, aio_cb cb, void *arg) {
+    int idx = -1;
+    for (int i = 0; i < AIO_MAX; ++i) {
+        if (reqs[i].state == AIO_FREE) { idx = i; break; }
+    }
+    if (idx < 0 || len < 0 || ensure_worker() < 0) return -1;
+    aio_req *r = &reqs[idx];
+    r->state = AIO_QUEUED;
+    r->op = op;
+    r->gen++;
+    strlcpy(r->name, name ? name : "", sizeof(r->name));
+    r->buf = buf;
+    r->len = len;
+    r->result = -1;
+    r->cb = cb;
+    r->arg = arg;
+    queue[qtail++ % AIO_MAX] = idx;
+    return handle_of(idx);
+}
+
+aio_t aio_fs_read(const char *name, void *buf, int max, aio_cb cb, void *arg) {
+    return submit(AIO_FS_READ, name, buf, max, cb, arg);
+}
+
+aio_t aio_fs_write(const char *name, const void *data, int len, aio_cb cb, void *arg) {
+    return submit(AIO_FS_WRITE, name, (void *)data, len, cb, arg);
+}
+
+aio_t aio_uart_write(const char *s, int len, aio_cb cb, void *arg) {
+    return submit(AIO_UART_WRITE, NULL, (void *)s, len, cb, arg);
+}
+
+int aio_poll(aio_t h, int *result) {
+    aio_req *r = req_of(h);
+    if (!r) return -1;
+    if (r->state != AIO_DONE) return 0;
+    if (result) *result = r->result;
+    return 1;
+}
+
+int aio_wait(aio_t h) {
+    int result;
+    return aio_wait_any(&h, 1, &result) < 0 ? -1 : result;
+}
+
+int aio_wait_any(const aio_t *hs, int n, int *result) {
+    for (;;) {
+        int known = 0;
+        for (int i = 0; i < n; ++i) {
+            aio_req *r = req_of(hs[i]);
+            if (!r) continue;
+            known = 1;
+            if (r->state == AIO_DONE) {
+                if (result) *result = r->result;
+                r->state = AIO_FREE;
+                return i;
+            }
+        }
+        if (!known || ensure_worker() < 0) return -1;
+        /* sleep until the worker finishes a batch (it wakes reqs) */
+        thread_block_on(reqs, worker);
+    }
+}
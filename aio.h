@@ -0,0 +1,32 @@
+#ifndef AIO_H
+#define AIO_H
+
+/* Asynchronous FS and console I/O for kernel threads. Submitting returns a
+   handle at once; an "aio" worker thread runs the queue in FIFO order, a
+   batch per turn, so the caller keeps computing until it needs the result.
+   Buffers must stay valid until the request completes. */
+
+#define AIO_MAX 32   /* requests in flight */
+#define AIO_BATCH 8  /* requests the worker completes before yielding */
+
+typedef int aio_t;   /* request handle; negative if the submit failed */
+
+/* runs on the worker once the request is done; a request with a callback
+   is released right after it, so don't wait on its handle */
+typedef void (*aio_cb)(aio_t h, int result, void *arg);
+
+/* results are what the synchronous call returns: bytes read (fs_read_buf),
+   0/-1 (fs_write_buf), bytes written (uart) */
+aio_t aio_fs_read(const char *name, void *buf, int max, aio_cb cb, void *arg);
+aio_t aio_fs_write(const char *name, const void *data, int len, aio_cb cb, void *arg);
+aio_t aio_uart_write(const char *s, int len, aio_cb cb, void *arg);
+
+/* 1 and the result in *result if h is done, 0 if pending, -1 if unknown */
+int aio_poll(aio_t h, int *result);
+/* wait for h, release it and return its result (-1 if unknown) */
+int aio_wait(aio_t h);
+/* wait until any of hs[0..n) is done; releases that one, stores its result
+   and returns its index (-1 if none of them is known) */
+int aio_wait_any(const aio_t *hs, int n, int *result);
+
+#endif
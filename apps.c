@@ -1,3 +1,4 @@
+#include "config.h"
 #include "uart.h"
 #include "string.h"
 #include "apps.h"
@@ -5,6 +6,12 @@
 #include "sync.h"
 #include "fs.h"
 #include "prog.h"
+#include "riscv.h"
+#include "vm.h"
+#include "aio.h"
+#include "task.h"
+#include "shell.h"
+#include "mbox.h"
 #include <stddef.h>
 
 /* Simple built-in apps. Each app is a function that returns. */
@@ -17,9 +24,9 @@ static void app_echo(void) {
     uart_puts("[app:echo] echoing... done\n");
 }
 
+#if CONFIG_DEMOS
 /* an app that prints "ping" then yields many times */
-static void app_pinger(void *unused) {
-    (void)unused;
+static void app_pinger(void) {
     for (int i = 0; i < 20; ++i) {
         uart_puts("[app:pinger] ping\n");
         /* give other threads a chance */
@@ -29,8 +36,7 @@ static void app_pinger(void *unused) {
 }
 
 /* an app that counts numbers and yields each time */
-static void app_counter(void *unused) {
-    (void)unused;
+static void app_counter(void) {
     for (int i = 1; i <= 20; ++i) {
         char buf[32]; int n = 0;
         const char *p = "[app:counter] ";
@@ -57,11 +63,19 @@ typedef struct {
     mutex_t lock;
     semaphore_t items;
     semaphore_t spaces;
+    int logged; /* producer log lines the aio worker has printed */
 } pc_state_t;
 
 static pc_state_t pc_state;
 
-static void producer(void *unused) {
+/* console output goes through aio so neither side stalls on the UART */
+static void producer_logged(aio_t h, int result, void *arg) {
+    (void)h; (void)result; (void)arg;
+    pc_state.logged++;
+}
+
+static int producer(void *unused) {
+    static const char line[] = "[producer] queued item\n";
     const char payload[] = { 'A', 'B', 'C', 'D', 'E', 'F' };
     for (int i = 0; i < 6; ++i) {
         sem_wait(&pc_state.spaces);
@@ -70,13 +84,22 @@ static void producer(void *unused) {
         pc_state.tail = (pc_state.tail + 1) % 4;
         mutex_unlock(&pc_state.lock);
         sem_post(&pc_state.items);
-        uart_puts("[producer] queued item\n");
+        /* fire and forget: the callback counts the line once printed */
+        if (aio_uart_write(line, sizeof(line) - 1, producer_logged, NULL) < 0) {
+            uart_puts(line);
+            pc_state.logged++;
+        }
         thread_yield();
     }
+    while (pc_state.logged < 6) thread_yield();
     uart_puts("[producer] done\n");
+    return 6;
 }
 
-static void consumer(void *unused) {
+static int consumer(void *unused) {
+    static char lines[6][20];
+    aio_t pending[6];
+    int npending = 0;
     for (int i = 0; i < 6; ++i) {
         sem_wait(&pc_state.items);
         mutex_lock(&pc_state.lock);
@@ -84,12 +107,23 @@ static void consumer(void *unused) {
         pc_state.head = (pc_state.head + 1) % 4;
         mutex_unlock(&pc_state.lock);
         sem_post(&pc_state.spaces);
-        uart_puts("[consumer] got ");
-        char buf[4]; buf[0] = item; buf[1] = '\n'; buf[2] = '\0';
-        uart_puts(buf);
+        int n = strlcpy(lines[i], "[consumer] got ", sizeof(lines[i]));
+        lines[i][n++] = item;
+        lines[i][n++] = '\n';
+        lines[i][n] = '\0';
+        aio_t h = aio_uart_write(lines[i], n, NULL, NULL);
+        if (h >= 0) pending[npending++] = h;
+        else uart_puts(lines[i]);
         thread_yield();
     }
+    /* reap the console writes in whatever order they finish */
+    while (npending > 0) {
+        int k = aio_wait_any(pending, npending, NULL);
+        if (k < 0) break;
+        pending[k] = pending[--npending];
+    }
     uart_puts("[consumer] done\n");
+    return 6;
 }
 
 static void app_syncdemo(void) {
@@ -97,19 +131,42 @@ static void app_syncdemo(void) {
     sem_init(&pc_state.items, 0);
     sem_init(&pc_state.spaces, 4);
     pc_state.head = pc_state.tail = 0;
+    pc_state.logged = 0;
 
-    thread_spawn(producer, NULL, "producer");
-    thread_spawn(consumer, NULL, "consumer");
+    tid_t p = thread_spawn(producer, NULL, "producer");
+    tid_t c = thread_spawn(consumer, NULL, "consumer");
     uart_puts("[app:syncdemo] spawned producer/consumer\n");
+    int made = 0, used = 0;
+    thread_join(p, &made);
+    thread_join(c, &used);
+    uart_puts("[app:syncdemo] joined: produced ");
+    uart_putu((unsigned long)made);
+    uart_puts(" consumed ");
+    uart_putu((unsigned long)used);
+    uart_puts("\n");
 }
 
 static void app_fs_demo(void) {
-    fs_write("hello.txt", "hi-from-fs");
+    static const char msg[] = "hi-from-fs";
     char buf[64];
-    if (fs_read("hello.txt", buf, sizeof(buf)) == 0) {
+    /* queue the write and the read-back, then keep computing while the aio
+       worker runs them (FIFO, so the read sees the write) */
+    aio_t w = aio_fs_write("hello.txt", msg, sizeof(msg) - 1, NULL, NULL);
+    aio_t r = aio_fs_read("hello.txt", buf, sizeof(buf) - 1, NULL, NULL);
+    unsigned long sum = 0;
+    for (int round = 0; round < 4; ++round) {
+        for (unsigned long i = 0; i < 10000; ++i) sum += i * (unsigned long)round;
+        thread_yield();
+    }
+    int ok = w >= 0 ? aio_wait(w) : fs_write("hello.txt", msg);
+    int n = r >= 0 ? aio_wait(r) : fs_read_buf("hello.txt", buf, sizeof(buf) - 1);
+    if (ok == 0 && n >= 0) {
+        buf[n] = '\0';
         uart_puts("[app:fs] read back: ");
         uart_puts(buf);
-        uart_puts("\n");
+        uart_puts(" (computed ");
+        uart_putu(sum);
+        uart_puts(" meanwhile)\n");
     }
 }
 
@@ -119,7 +176,7 @@ static void app_prog_demo(void) {
     prog_run("script1");
 }
 
-static void sleepy_worker(void *arg) {
+static int sleepy_worker(void *arg) {
     int id = (int)(long)arg;
     for (int i = 0; i < 3; ++i) {
         char buf[48]; int n = 0;
@@ -146,18 +203,29 @@ static void sleepy_worker(void *arg) {
         thread_sleep(1 + id);
     }
     uart_puts("[sleepy] done\n");
+    return 1 + id;
 }
 
 static void app_sleepers(void) {
+    tid_t tids[3];
     for (int i = 0; i < 3; ++i) {
-        thread_spawn(sleepy_worker, (void *)(long)i, "sleepy");
+        tids[i] = thread_spawn(sleepy_worker, (void *)(long)i, "sleepy");
     }
     uart_puts("[app:sleepers] spawned sleepy threads\n");
+    /* each worker returns its tick count; join sleeps until it exits */
+    int ticks = 0;
+    for (int i = 0; i < 3; ++i) {
+        int st;
+        if (tids[i] >= 0 && thread_join(tids[i], &st) == 0) ticks += st;
+    }
+    uart_puts("[app:sleepers] joined, ticks per round summed: ");
+    uart_putu((unsigned long)ticks);
+    uart_puts("\n");
 }
 
 static barrier_t sync_barrier;
 
-static void barrier_worker(void *arg) {
+static int barrier_worker(void *arg) {
     int id = (int)(long)arg;
     for (int step = 0; step < 3; ++step) {
         char buf[64]; int n = 0;
@@ -183,14 +251,19 @@ static void barrier_worker(void *arg) {
         thread_sleep(1 + id);
     }
     uart_puts("[barrier worker] done\n");
+    return 0;
 }
 
 static void app_barrier_demo(void) {
+    static const char *names[3] = { "bar0", "bar1", "bar2" };
+    tid_t tids[3];
     barrier_init(&sync_barrier, 3);
-    thread_spawn(barrier_worker, (void *)0, "bar0");
-    thread_spawn(barrier_worker, (void *)1, "bar1");
-    thread_spawn(barrier_worker, (void *)2, "bar2");
+    for (int i = 0; i < 3; ++i) tids[i] = thread_spawn(barrier_worker, (void *)(long)i, names[i]);
     uart_puts("[app:barrier] 3 workers waiting on barrier\n");
+    for (int i = 0; i < 3; ++i) {
+        if (tids[i] >= 0) thread_join(tids[i], NULL);
+    }
+    uart_puts("[app:barrier] all workers joined\n");
 }
 
 static void app_prog_file_demo(void) {
@@ -217,21 +290,358 @@ static void app_sum(void) {
     uart_puts(buf);
 }
 
+/* context-switch cost with and without an address-space change */
+#define BENCH_ROUNDS 2000
+static volatile int bench_left;
+static volatile int bench_switches;
+
+static int bench_worker(void *unused) {
+    (void)unused;
+    while (bench_left > 0) {
+        bench_left--;
+        bench_switches++;
+        thread_yield();
+    }
+    return 0;
+}
+
+static unsigned long switch_bench(int own_spaces) {
+    vm_space *vs[2] = { NULL, NULL };
+    tid_t tids[2] = { -1, -1 };
+    bench_left = BENCH_ROUNDS;
+    bench_switches = 0;
+    for (int i = 0; i < 2; ++i) {
+        tids[i] = thread_spawn(bench_worker, NULL, own_spaces ? "bench-vm" : "bench");
+        if (tids[i] < 0) break;
+        if (own_spaces && (vs[i] = vm_space_create()) != NULL) thread_set_satp(tids[i], vs[i]->satp);
+    }
+    unsigned long t0 = r_time();
+    while (bench_left > 0) {
+        bench_switches++;
+        thread_yield();
+    }
+    unsigned long dt = r_time() - t0;
+    /* the workers must be gone before their spaces are freed */
+    for (int i = 0; i < 2; ++i) {
+        if (tids[i] >= 0) thread_join(tids[i], NULL);
+        vm_space_destroy(vs[i]);
+    }
+    return bench_switches ? dt / (unsigned long)bench_switches : 0;
+}
+
+static void app_vm_bench(void) {
+    unsigned long same = switch_bench(0);
+    unsigned long own = switch_bench(1);
+    uart_puts("[vm-bench] ticks/switch kernel-space:");
+    uart_putu(same);
+    uart_puts(" own-spaces:");
+    uart_putu(own);
+    uart_puts(" asids:");
+    uart_putu(vm_asids());
+    uart_puts("\n");
+}
+
+/* task fan-out demo: many periodic tickers report to one collector over a
+   channel, all on the single "tasks" thread */
+#define TICKERS 1000
+#define TICKS 5
+
+static task_chan_t tick_chan;
+static struct {
+    void *msg;          /* last message received (survives waits) */
+    long want;          /* ticks to collect */
+    unsigned long start;
+} tick_state;
+
+static int ticker(task_t *t) {
+    TASK_BEGIN(t);
+    for (t->local[0] = 0; t->local[0] < TICKS; t->local[0]++) {
+        /* periods 10..59 ms so wakeups spread over the timer heap */
+        TASK_SLEEP_MS(t, 10 + (unsigned long)t->arg % 50);
+        TASK_CHAN_SEND(t, &tick_chan, t->arg);
+    }
+    TASK_END(t);
+}
+
+static int tick_collector(task_t *t) {
+    TASK_BEGIN(t);
+    while (t->local[0] < tick_state.want) {
+        TASK_CHAN_RECV(t, &tick_chan, tick_state.msg);
+        t->local[0]++;
+    }
+    uart_puts("[tasks] ");
+    uart_putu((unsigned long)t->local[0]);
+    uart_puts(" ticks from ");
+    uart_putu((unsigned long)(tick_state.want / TICKS));
+    uart_puts(" tasks in ");
+    uart_putu((r_time() - tick_state.start) / (TIMEBASE_HZ / 1000));
+    uart_puts(" ms, ");
+    uart_putu(sizeof(task_t));
+    uart_puts(" bytes per task\n");
+    TASK_END(t);
+}
+
+static void app_tasks(void) {
+    task_chan_init(&tick_chan);
+    tick_state.start = r_time();
+    if (!task_spawn(tick_collector, NULL)) {
+        uart_puts("[tasks] no room\n");
+        return;
+    }
+    int n = 0;
+    while (n < TICKERS && task_spawn(ticker, (void *)(unsigned long)n)) n++;
+    /* the collector first runs once we return, so it sees the real count */
+    tick_state.want = (long)n * TICKS;
+    uart_puts("[tasks] spawned ");
+    uart_putu((unsigned long)n);
+    uart_puts(" tickers\n");
+}
+
+/* lazy FP switching: two threads interleave double-precision sums while a
+   third stays integer-only; each FP sum must survive the other's use of the
+   same registers */
+#define FP_TERMS 1000
+
+static int fp_worker(void *arg) {
+    double scale = (double)(long)arg + 1.0, sum = 0.0;
+    for (int k = 1; k <= FP_TERMS; ++k) {
+        sum += scale * k * 0.5;
+        if (k % 100 == 0) thread_yield();
+    }
+    /* scale * FP_TERMS * (FP_TERMS + 1) / 4, exact in a double */
+    return (int)sum;
+}
+
+static int int_worker(void *arg) {
+    (void)arg;
+    int sum = 0;
+    for (int k = 1; k <= FP_TERMS; ++k) {
+        sum += k;
+        if (k % 100 == 0) thread_yield();
+    }
+    return sum;
+}
+
+static void app_fp(void) {
+    tid_t tids[3];
+    tids[0] = thread_spawn(fp_worker, (void *)0L, "fp0");
+    tids[1] = thread_spawn(fp_worker, (void *)1L, "fp1");
+    tids[2] = thread_spawn(int_worker, NULL, "int");
+    int ok = 1;
+    for (int i = 0; i < 3; ++i) {
+        int st = -1;
+        int want = i < 2 ? (i + 1) * FP_TERMS * (FP_TERMS + 1) / 4 : FP_TERMS * (FP_TERMS + 1) / 2;
+        if (tids[i] < 0 || thread_join(tids[i], &st) < 0 || st != want) ok = 0;
+    }
+    uart_puts(ok ? "[app:fp] sums correct across switches\n" : "[app:fp] FP state corrupted\n");
+}
+
+/* mailbox pipeline: gen -> double -> sum. gen posts batches of pooled
+   buffers, the doubling stage rewrites each buffer in place and forwards
+   the same pointer, and the sink frees it; an empty message ends the run */
+#define MBOX_NUMS 100
+#define MBOX_BATCH 8
+
+static int msg_int(const mbox_msg *m) {
+    int v = 0;
+    for (int i = 0; i < m->len; ++i) v = v * 10 + (m->data[i] - '0');
+    return v;
+}
+
+static void msg_set_int(mbox_msg *m, int v) {
+    char digits[12]; int d = 0;
+    if (v == 0) digits[d++] = '0';
+    while (v) { digits[d++] = '0' + (v % 10); v /= 10; }
+    m->len = 0;
+    while (d) m->data[m->len++] = digits[--d];
+}
+
+static int mbox_gen(void *arg) {
+    int out = (int)(long)arg;
+    mbox_msg *batch[MBOX_BATCH];
+    int n = 0;
+    for (int v = 1; v <= MBOX_NUMS + 1; ++v) {
+        mbox_msg *m;
+        while ((m = mbox_msg_alloc()) == NULL) thread_yield(); /* pool drained: wait for the sink */
+        if (v <= MBOX_NUMS) msg_set_int(m, v);
+        batch[n++] = m;
+        if (n == MBOX_BATCH || v == MBOX_NUMS + 1) {
+            if (mbox_post(out, batch, n, 1) != n) return -1;
+            n = 0;
+        }
+    }
+    return 0;
+}
+
+static int mbox_double(void *arg) {
+    int in = mbox_find("pipe-in"), out = (int)(long)arg;
+    for (;;) {
+        mbox_msg *m = mbox_take(in, 1);
+        if (!m) return -1;
+        int last = m->len == 0;
+        if (!last) msg_set_int(m, 2 * msg_int(m));
+        if (mbox_post(out, &m, 1, 1) != 1) return -1;
+        if (last) return 0;
+    }
+}
+
+static int mbox_sum(void *arg) {
+    int in = (int)(long)arg, sum = 0;
+    for (;;) {
+        mbox_msg *m = mbox_take(in, 1);
+        if (!m) return -1;
+        int last = m->len == 0;
+        sum += msg_int(m);
+        mbox_msg_free(m);
+        if (last) return sum;
+    }
+}
+
+static void app_mbox(void) {
+    int a = mbox_create("pipe-in", 0), b = mbox_create("pipe-out", 0);
+    if (a < 0 || b < 0) {
+        uart_puts("[app:mbox] no mailboxes\n");
+        return;
+    }
+    unsigned long t0 = r_time();
+    tid_t tids[3];
+    tids[0] = thread_spawn(mbox_gen, (void *)(long)a, "mb-gen");
+    tids[1] = thread_spawn(mbox_double, (void *)(long)b, "mb-double");
+    tids[2] = thread_spawn(mbox_sum, (void *)(long)b, "mb-sum");
+    int st = -1;
+    for (int i = 0; i < 3; ++i) {
+        if (tids[i] >= 0) thread_join(tids[i], i == 2 ? &st : NULL);
+    }
+    uart_puts("[app:mbox] sum ");
+    uart_putu((unsigned long)st);
+    uart_puts(st == MBOX_NUMS * (MBOX_NUMS + 1) ? " (ok)" : " (wrong)");
+    uart_puts(" in ");
+    uart_putu((r_time() - t0) / (TIMEBASE_HZ / 1000000));
+    uart_puts(" us\n");
+    mbox_destroy(a);
+    mbox_destroy(b);
+}
+
+/* benchmark suite for comparing builds (PROFILE=bench, bench-lto, PGO):
+   each case runs BENCH_RUNS times and reports its fastest run, and its
+   speedup over the baseline built in with BENCH_BASE; `pgo.py compare`
+   lines up two logs */
+#define BENCH_RUNS 5
+
+/* the baseline's time for case, from "case=us case=us ..."; 0 if none */
+static unsigned long bench_base(const char *name) {
+    const char *s = CONFIG_BENCH_BASE;
+    unsigned long n = strlen(name);
+    while (*s) {
+        while (*s == ' ') s++;
+        int match = strncmp(s, name, n) == 0 && s[n] == '=';
+        while (*s && *s != '=') s++;
+        if (!*s) break;
+        unsigned long us = 0;
+        for (s++; *s >= '0' && *s <= '9'; s++) us = us * 10 + (unsigned long)(*s - '0');
+        if (match) return us;
+    }
+    return 0;
+}
+
+/* " (<base/us>x base)" to two places, if there is a baseline for name */
+static void bench_ratio(const char *name, unsigned long us) {
+    unsigned long base = bench_base(name);
+    if (!base || !us) return;
+    unsigned long r = (base * 100 + us / 2) / us;
+    uart_puts(" (");
+    uart_putu(r / 100);
+    uart_puts(".");
+    uart_putc((char)('0' + r / 10 % 10));
+    uart_putc((char)('0' + r % 10));
+    uart_puts("x base)");
+}
+
+static void bench_switch(void) {
+    switch_bench(0);
+    switch_bench(1);
+}
+
+/* the script interpreter's dispatch loop */
+static void bench_prog(void) {
+    static const char script[] =
+        "set r0 0;loop 5000;set r0 r0 + 3;set r1 r0 % 7;if r1 == 0;set r2 r2 + 1;end;end;exit";
+    if (prog_load("bench", script, 0) < 0) return;
+    int tid = prog_run("bench");
+    if (tid >= 0) thread_join(tid, NULL);
+    prog_drop("bench");
+}
+
+static const struct {
+    const char *name;
+    void (*fn)(void);
+} bench_cases[] = {
+    { "switch", bench_switch },
+    { "mbox", app_mbox },
+    { "fp", app_fp },
+    { "prog", bench_prog },
+};
+
+static void app_bench(void) {
+    unsigned long total = 0;
+    uart_puts("[bench] begin\n");
+    for (unsigned long i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); ++i) {
+        unsigned long best = ~0UL;
+        for (int r = 0; r < BENCH_RUNS; ++r) {
+            unsigned long t0 = r_time();
+            bench_cases[i].fn();
+            unsigned long dt = r_time() - t0;
+            if (dt < best) best = dt;
+        }
+        best /= TIMEBASE_HZ / 1000000;
+        total += best;
+        uart_puts("[bench] ");
+        uart_puts(bench_cases[i].name);
+        uart_puts(" ");
+        uart_putu(best);
+        uart_puts(" us");
+        bench_ratio(bench_cases[i].name, best);
+        uart_puts("\n");
+    }
+    uart_puts("[bench] total ");
+    uart_putu(total);
+    uart_puts(" us");
+    bench_ratio("total", total);
+    uart_puts("\n");
+}
+
+/* a thread that never yields for 300 ms, for the watchdog (`wdog`) */
+static void app_spin(void) {
+    unsigned long end = r_time() + 3 * TIMEBASE_HZ / 10;
+    while (r_time() < end) {
+    }
+    uart_puts("[app:spin] done\n");
+}
+#endif /* CONFIG_DEMOS */
+
 typedef void (*app_fn)(void);
 typedef struct { const char *name; app_fn fn; } app_entry;
 
 static app_entry apps[] = {
     { "hello", app_hello },
     { "echo",  app_echo  },
+#if CONFIG_DEMOS
     { "sum",   app_sum   },
-    { "pinger", (app_fn)app_pinger },
-    { "counter", (app_fn)app_counter },
+    { "pinger", app_pinger },
+    { "counter", app_counter },
     { "sync", app_syncdemo },
     { "fs-demo", app_fs_demo },
     { "prog-demo", app_prog_demo },
     { "sleepers", app_sleepers },
     { "barrier", app_barrier_demo },
     { "prog-file", app_prog_file_demo },
+    { "vm-bench", app_vm_bench },
+    { "tasks", app_tasks },
+    { "fp", app_fp },
+    { "mbox", app_mbox },
+    { "spin", app_spin },
+    { "bench", app_bench },
+#endif
 
     { NULL, NULL }
 };
@@ -252,6 +662,13 @@ int app_run(const char *name) {
     return -1;
 }
 
+int app_exists(const char *name) {
+    for (int i = 0; apps[i].name; ++i) {
+        if (!strcmp(apps[i].name, name)) return 1;
+    }
+    return 0;
+}
+
 void app_list(void) {
     uart_puts("apps:\n");
     for (int i = 0; apps[i].name; ++i) {
@@ -261,29 +678,50 @@ void app_list(void) {
     }
 }
 
+/* thread body for a spawned app: apps don't report a status */
+static int app_thread(void *arg) {
+    ((const app_entry *)arg)->fn();
+    return 0;
+}
+
 /* spawn an app as a new cooperative thread. Returns tid or -1. */
 int app_spawn(const char *name) {
+    return app_spawn_prio(name, THREAD_PRIO_DEFAULT);
+}
+
+int app_spawn_prio(const char *name, int prio) {
     for (int i = 0; apps[i].name; ++i) {
         if (!strcmp(apps[i].name, name)) {
-            /* spawn thread; wrapper matches thread_fn(void*) */
-            /* cast to thread_fn taking void*; arg unused */
-            tid_t tid = thread_spawn((thread_fn)apps[i].fn, NULL, name);
+            tid_t tid = thread_spawn_prio(app_thread, &apps[i], name, prio);
             if (tid < 0) return -1;
             uart_puts("spawned ");
             uart_puts(name);
             uart_puts(" tid:");
-            /* print tid */
-            char buf[16]; int n=0;
-            int v = tid;
-            char digits[8]; int d=0;
-            if (v==0) digits[d++]='0';
-            while (v) { digits[d++] = '0' + (v%10); v/=10; }
-            for (int k=d-1;k>=0;--k) buf[n++]=digits[k];
-            buf[n]=0;
-            uart_puts(buf);
+            uart_puti(tid);
             uart_puts("\n");
             return (int)tid;
         }
     }
     return -1;
 }
+
+static int run_cmd(const char *args) {
+    char name[32], pbuf[8];
+    shell_word(&args, name, sizeof(name));
+    int prio = shell_word(&args, pbuf, sizeof(pbuf)) ? shell_int(pbuf) : THREAD_PRIO_DEFAULT;
+    int tid = app_spawn_prio(name, prio);
+    if (tid < 0) uart_puts("no such app (or bad priority)\n");
+    return tid > 0 ? tid : 0;
+}
+
+static int ls_cmd(const char *args) {
+    (void)args;
+    app_list();
+    return 0;
+}
+
+void apps_init(void) {
+    shell_register("run", run_cmd, "run <app> [prio]");
+    shell_register("ls", ls_cmd, "ls");
+    shell_register("apps", ls_cmd, "apps");
+}
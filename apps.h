@@ -6,7 +6,15 @@ int app_run(const char *name);
 
 /* spawn app as background thread; return tid or -1 */
 int app_spawn(const char *name);
+/* same, at a thread priority (thread.h) */
+int app_spawn_prio(const char *name, int prio);
 
 void app_list(void);
 
+/* register the run/ls/apps shell commands */
+void apps_init(void);
+
+/* 1 if a built-in app with this name exists */
+int app_exists(const char *name);
+
 #endif
@@ -0,0 +1,58 @@
+#include "console.h"
+#include "uart.h"
+#include "plic.h"
+#include "platform.h"
+#include "thread.h"
+
+#define CONSOLE_BUF 128 /* power of two */
+
+static char rx[CONSOLE_BUF];
+static unsigned int rx_head, rx_tail;
+static int intr; /* ^C seen and not yet taken */
+static tid_t waiter;
+
+void console_init(void) {
+    plic_enable(platform.uart_irq);
+    uart_rx_irq(1);
+}
+
+void console_poll(void) {
+    int got = 0;
+    while (uart_haschar()) {
+        char c = (char)uart_getc();
+        if (c == CONSOLE_INTR) {
+            /* for the shell, not for whoever reads input */
+            intr = 1;
+            if (waiter) thread_interrupt(waiter);
+            continue;
+        }
+        /* a full buffer drops the newest bytes */
+        if (rx_tail - rx_head < CONSOLE_BUF) rx[rx_tail++ % CONSOLE_BUF] = c;
+        got = 1;
+    }
+    if (got) thread_wake(rx);
+}
+
+int console_trygetc(void) {
+    if (rx_head == rx_tail) return -1;
+    return (unsigned char)rx[rx_head++ % CONSOLE_BUF];
+}
+
+int console_getc(void) {
+    int c;
+    while ((c = console_trygetc()) < 0) {
+        /* the idle loop polls the UART when its interrupt fires */
+        thread_block(rx);
+    }
+    return c;
+}
+
+void console_set_waiter(tid_t tid) {
+    waiter = tid;
+}
+
+int console_take_intr(void) {
+    int was = intr;
+    intr = 0;
+    return was;
+}
@@ -0,0 +1,24 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "thread.h"
+
+/* Console input: UART bytes are buffered by console_poll (called when the
+   UART interrupt is seen) and handed to threads blocked in console_getc. */
+
+void console_init(void);
+/* move received bytes from the UART into the buffer, waking readers */
+void console_poll(void);
+/* next input byte; blocks the calling thread while there is none */
+int console_getc(void);
+/* next input byte, or -1 if none is buffered */
+int console_trygetc(void);
+
+#define CONSOLE_INTR 3 /* ^C, kept out of the input buffer */
+/* 1 if ^C was typed since the last call */
+int console_take_intr(void);
+/* thread whose thread_join ^C interrupts (the shell waiting for its
+   foreground job), 0 = none */
+void console_set_waiter(tid_t tid);
+
+#endif
@@ -0,0 +1,116 @@
+#include "elf.h"
+#include "kalloc.h"
+#include "string.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Minimal ELF64 loader for native user programs: static executables only,
+   PT_LOAD segments copied into freshly allocated user pages. */
+
+typedef struct {
+    unsigned char ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint64_t entry;
+    uint64_t phoff;
+    uint64_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} elf64_ehdr;
+
+typedef struct {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t vaddr;
+    uint64_t paddr;
+    uint64_t filesz;
+    uint64_t memsz;
+    uint64_t align;
+} elf64_phdr;
+
+#define ET_EXEC 2
+#define EM_RISCV 243
+#define PT_LOAD 1
+#define PF_X 1
+#define PF_W 2
+#define PF_R 4
+
+#define STACK_BASE (USER_STACK_TOP - USER_STACK_PAGES * PAGE_SIZE)
+
+static const elf64_phdr *phdr(const void *image, int i) {
+    const elf64_ehdr *eh = (const elf64_ehdr *)image;
+    return (const elf64_phdr *)((const char *)image + eh->phoff + (unsigned long)i * eh->phentsize);
+}
+
+int elf_check(const void *image, unsigned long len, const char **why) {
+    const elf64_ehdr *eh = (const elf64_ehdr *)image;
+    *why = NULL;
+    if (len < sizeof(*eh) || eh->ident[0] != 0x7f || eh->ident[1] != 'E' ||
+        eh->ident[2] != 'L' || eh->ident[3] != 'F') {
+        *why = "not an ELF file";
+    } else if (eh->ident[4] != 2 || eh->ident[5] != 1 || eh->machine != EM_RISCV) {
+        *why = "not RV64 little-endian";
+    } else if (eh->type != ET_EXEC) {
+        *why = "not a static executable";
+    } else if (eh->phentsize != sizeof(elf64_phdr) ||
+               eh->phoff > len || (unsigned long)eh->phnum * sizeof(elf64_phdr) > len - eh->phoff) {
+        *why = "bad program headers";
+    }
+    if (*why) return -1;
+
+    /* bounds are compared by subtraction: a crafted header must not be able
+       to wrap offset + size past the check */
+    int loads = 0;
+    for (int i = 0; i < eh->phnum; ++i) {
+        const elf64_phdr *ph = phdr(image, i);
+        if (ph->type != PT_LOAD) continue;
+        if (ph->filesz > ph->memsz || ph->offset > len || ph->filesz > len - ph->offset) {
+            *why = "segment outside the file";
+        } else if (ph->vaddr < USER_BASE || ph->vaddr > USER_LOAD_TOP ||
+                   ph->memsz > USER_LOAD_TOP - ph->vaddr) {
+            *why = "segment outside the user slot";
+        }
+        if (*why) return -1;
+        loads++;
+    }
+    if (!loads) *why = "nothing to load";
+    else if (eh->entry < USER_BASE || eh->entry >= USER_LOAD_TOP) *why = "entry outside the user slot";
+    return *why ? -1 : 0;
+}
+
+unsigned long elf_load(vm_space *vs, const void *image, unsigned long len, unsigned long *sp) {
+    const elf64_ehdr *eh = (const elf64_ehdr *)image;
+    (void)len; /* bounds were checked by elf_check at load time, so the
+                  sums below stay inside the file and the user slot */
+    for (int i = 0; i < eh->phnum; ++i) {
+        const elf64_phdr *ph = phdr(image, i);
+        if (ph->type != PT_LOAD) continue;
+        unsigned long flags = PTE_U;
+        if (ph->flags & PF_R) flags |= PTE_R;
+        if (ph->flags & PF_W) flags |= PTE_W;
+        if (ph->flags & PF_X) flags |= PTE_X;
+        const unsigned char *src = (const unsigned char *)image + ph->offset;
+        unsigned long end = ph->vaddr + ph->memsz;
+        for (unsigned long va = ph->vaddr & ~(PAGE_SIZE - 1); va < end; va += PAGE_SIZE) {
+            unsigned char *page = (unsigned char *)vm_alloc_page(vs, va, flags);
+            if (!page) return 0;
+            /* the file-backed part of this page; the rest stays zero (bss) */
+            unsigned long lo = va > ph->vaddr ? va : ph->vaddr;
+            unsigned long hi = va + PAGE_SIZE;
+            if (hi > ph->vaddr + ph->filesz) hi = ph->vaddr + ph->filesz;
+            if (lo < hi) memcpy(page + (lo - va), src + (lo - ph->vaddr), hi - lo);
+        }
+    }
+    for (unsigned long va = STACK_BASE; va < USER_STACK_TOP; va += PAGE_SIZE) {
+        if (!vm_alloc_page(vs, va, PTE_U | PTE_R | PTE_W)) return 0;
+    }
+    *sp = USER_STACK_TOP;
+    return eh->entry;
+}
@@ -0,0 +1,22 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include "vm.h"
+#include "kalloc.h"
+
+/* user stack: the top pages of the user slot */
+#define USER_STACK_PAGES 2
+#define USER_STACK_TOP USER_TOP
+/* io ring page (ring.c), a guard page below the stack */
+#define USER_RING_VA (USER_STACK_TOP - (USER_STACK_PAGES + 2) * PAGE_SIZE)
+/* loadable segments end below the fixed mappings */
+#define USER_LOAD_TOP USER_RING_VA
+
+/* 0 if image is a static RV64 executable whose segments fit below
+   USER_LOAD_TOP, else -1 (reason in *why) */
+int elf_check(const void *image, unsigned long len, const char **why);
+/* map and fill its segments and a stack in vs; returns the entry point and
+   the initial sp, or 0 if out of memory */
+unsigned long elf_load(vm_space *vs, const void *image, unsigned long len, unsigned long *sp);
+
+#endif
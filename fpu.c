@@ -0,0 +1,45 @@
+#include "fpu.h"
+#include "riscv.h"
+#include "string.h"
+#include <stddef.h>
+
+_Static_assert(offsetof(fpu_state, fcsr) == 256, "fpusave.S hard-codes the fcsr offset");
+
+fpu_state *fpu_owner;
+static int owner_dirty; /* the owner wrote the registers since its last save */
+
+void fpu_init(void) {
+    c_sstatus(SSTATUS_FS | SSTATUS_VS);
+    fpu_owner = NULL;
+}
+
+void fpu_switch_slow(fpu_state *next) {
+    /* FS is only ever on while the owner runs, so Dirty here is its write */
+    if ((r_sstatus() & SSTATUS_FS) == SSTATUS_FS_DIRTY) owner_dirty = 1;
+    c_sstatus(SSTATUS_FS);
+    if (next == fpu_owner) s_sstatus(SSTATUS_FS_CLEAN);
+}
+
+int fpu_trap(fpu_state *cur, unsigned long *sstatus) {
+    if (*sstatus & SSTATUS_FS) return 0;
+    s_sstatus(SSTATUS_FS_CLEAN); /* for the fsd/fld below */
+    if (fpu_owner != cur) {
+        if (fpu_owner && owner_dirty) fpu_save(fpu_owner);
+        fpu_restore(cur);
+        fpu_owner = cur;
+        owner_dirty = 0;
+    }
+    /* the loads marked FS dirty, but the registers match cur's area */
+    c_sstatus(SSTATUS_FS);
+    s_sstatus(SSTATUS_FS_CLEAN);
+    *sstatus = (*sstatus & ~SSTATUS_FS) | SSTATUS_FS_CLEAN;
+    return 1;
+}
+
+void fpu_drop(fpu_state *area) {
+    if (fpu_owner == area) {
+        fpu_owner = NULL;
+        c_sstatus(SSTATUS_FS);
+    }
+    memset(area, 0, sizeof(*area));
+}
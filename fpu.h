@@ -0,0 +1,40 @@
+#ifndef FPU_H
+#define FPU_H
+
+/* Lazy FP context switching. sstatus.FS is left Off for every thread but the
+   one whose values are live in f0-f31, so a thread that never touches the FPU
+   costs the scheduler one pointer test per switch. The first FP instruction
+   of any other thread traps (illegal instruction); fpu_trap then saves the
+   old owner's registers, if it dirtied them, and loads the new owner's.
+
+   There is no vector state: the kernel is built for rv64gc, so VS stays Off
+   and a vector instruction is an ordinary illegal-instruction fault. */
+
+typedef struct {
+    unsigned long f[32];
+    unsigned long fcsr;
+} fpu_state;
+
+/* save area whose values are in the FP registers, NULL = none */
+extern fpu_state *fpu_owner;
+
+/* turn FS and VS off: nobody owns the FPU yet */
+void fpu_init(void);
+/* every context switch, before resuming the thread owning next */
+void fpu_switch_slow(fpu_state *next);
+static inline void fpu_switch(fpu_state *next) {
+    if (fpu_owner) fpu_switch_slow(next);
+}
+/* illegal-instruction trap with FS off: hand the FPU to the trapping thread
+   (its save area is cur) and set FS in the frame so the instruction is
+   retried. Returns 0 if the FPU was already on, i.e. a real fault. */
+int fpu_trap(fpu_state *cur, unsigned long *sstatus);
+/* the thread owning area exits or its slot is reused: release the FPU if it
+   holds it and zero the area, the state a new thread starts from */
+void fpu_drop(fpu_state *area);
+
+/* fpusave.S */
+void fpu_save(fpu_state *area);
+void fpu_restore(const fpu_state *area);
+
+#endif
@@ -1,10 +1,12 @@
 #include "fs.h"
 #include "string.h"
 #include "uart.h"
+#include "shell.h"
 
 typedef struct {
     int used;
     char name[FS_NAME_LEN];
+    int len; /* bytes in data; text files also keep a NUL after them */
     char data[FS_DATA_LEN];
 } fs_file;
 
@@ -17,49 +19,149 @@ static int find_slot(const char *name) {
     return -1;
 }
 
+static int fs_cmd(const char *args) {
+    args = shell_skip(args);
+    if (!strcmp(args, "ls")) {
+        fs_list();
+        return 0;
+    }
+    if (!strcmp(args, "format")) {
+        fs_format();
+        uart_puts("fs formatted\n");
+        return 0;
+    }
+    if (!strncmp(args, "read ", 5)) {
+        char name[32];
+        args += 5;
+        shell_word(&args, name, sizeof(name));
+        char buf[128];
+        if (fs_read(name, buf, sizeof(buf)) == 0) {
+            uart_puts(buf);
+            uart_puts("\n");
+        } else {
+            uart_puts("fs read failed\n");
+        }
+        return 0;
+    }
+    if (!strncmp(args, "write ", 6)) {
+        char name[32];
+        args += 6;
+        shell_word(&args, name, sizeof(name));
+        args = shell_skip(args);
+        if (fs_write(name, args) == 0) {
+            uart_puts("fs wrote ");
+            uart_puts(name);
+            uart_puts("\n");
+        } else {
+            uart_puts("fs write failed\n");
+        }
+        return 0;
+    }
+    if (!strncmp(args, "rm ", 3)) {
+        char name[32];
+        args += 3;
+        shell_word(&args, name, sizeof(name));
+        if (fs_delete(name) == 0) uart_puts("fs removed\n");
+        else uart_puts("fs rm failed\n");
+        return 0;
+    }
+    uart_puts("fs usage: fs ls|format|read <f>|write <f> <data>|rm <f>\n");
+    return 0;
+}
+
 void fs_init(void) {
-    fs_format();
+    /* files[] starts zeroed (.bss): already an empty FS */
+    shell_register("fs", fs_cmd, "fs ls|read <f>|write <f> <data>|rm <f>|format");
 }
 
 void fs_format(void) {
     for (int i = 0; i < FS_MAX_FILES; ++i) {
         files[i].used = 0;
         files[i].name[0] = '\0';
+        files[i].len = 0;
         files[i].data[0] = '\0';
     }
 }
 
-int fs_write(const char *name, const char *data) {
-    if (!name || !data) return -1;
+static int alloc_slot(const char *name) {
     int idx = find_slot(name);
     if (idx < 0) {
         for (int i = 0; i < FS_MAX_FILES; ++i) {
             if (!files[i].used) { idx = i; break; }
         }
     }
+    return idx;
+}
+
+int fs_write(const char *name, const char *data) {
+    if (!name || !data) return -1;
+    int idx = alloc_slot(name);
     if (idx < 0) return -1;
     files[idx].used = 1;
     strlcpy(files[idx].name, name, FS_NAME_LEN);
     strlcpy(files[idx].data, data, FS_DATA_LEN);
+    files[idx].len = (int)strlen(files[idx].data);
+    return 0;
+}
+
+int fs_write_buf(const char *name, const void *data, int len) {
+    if (!name || !data || len < 0 || len > FS_DATA_LEN) return -1;
+    int idx = alloc_slot(name);
+    if (idx < 0) return -1;
+    files[idx].used = 1;
+    strlcpy(files[idx].name, name, FS_NAME_LEN);
+    memcpy(files[idx].data, data, (unsigned long)len);
+    if (len < FS_DATA_LEN) files[idx].data[len] = '\0';
+    files[idx].len = len;
     return 0;
 }
 
 int fs_read(const char *name, char *out, int out_sz) {
     int idx = find_slot(name);
     if (idx < 0 || !out || out_sz <= 0) return -1;
-    strlcpy(out, files[idx].data, (unsigned long)out_sz);
+    int n = files[idx].len < out_sz - 1 ? files[idx].len : out_sz - 1;
+    memcpy(out, files[idx].data, (unsigned long)n);
+    out[n] = '\0';
     return 0;
 }
 
+int fs_read_buf(const char *name, void *out, int max) {
+    int idx = find_slot(name);
+    if (idx < 0 || !out || max < 0) return -1;
+    int n = files[idx].len < max ? files[idx].len : max;
+    memcpy(out, files[idx].data, (unsigned long)n);
+    return n;
+}
+
+int fs_size(const char *name) {
+    int idx = find_slot(name);
+    if (idx < 0) return -1;
+    return files[idx].len;
+}
+
 int fs_delete(const char *name) {
     int idx = find_slot(name);
     if (idx < 0) return -1;
     files[idx].used = 0;
     files[idx].name[0] = '\0';
+    files[idx].len = 0;
     files[idx].data[0] = '\0';
     return 0;
 }
 
+void fs_get_stats(fs_stats *st) {
+    st->files = 0;
+    st->bytes = 0;
+    for (int i = 0; i < FS_MAX_FILES; ++i) {
+        if (files[i].used) {
+            st->files++;
+            st->bytes += (unsigned long)files[i].len;
+        }
+    }
+    st->allocated = (unsigned long)st->files * FS_DATA_LEN;
+    st->table = sizeof(files);
+}
+
 void fs_list(void) {
     uart_puts("fs:\n");
     for (int i = 0; i < FS_MAX_FILES; ++i) {
@@ -67,15 +169,7 @@ void fs_list(void) {
             uart_puts(" - ");
             uart_puts(files[i].name);
             uart_puts(" (");
-            /* show length */
-            char buf[8]; int n = 0;
-            unsigned long len = strlen(files[i].data);
-            char digits[8]; int d = 0;
-            if (len == 0) digits[d++] = '0';
-            while (len) { digits[d++] = '0' + (len % 10); len /= 10; }
-            for (int k = d - 1; k >= 0; --k) buf[n++] = digits[k];
-            buf[n] = '\0';
-            uart_puts(buf);
+            uart_putu((unsigned long)files[i].len);
             uart_puts("b)\n");
         }
     }
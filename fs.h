@@ -1,15 +1,30 @@
 #ifndef FS_H
 #define FS_H
 
-#define FS_MAX_FILES 16
+#include "config.h"
+
+#define FS_MAX_FILES CONFIG_FS_MAX_FILES
 #define FS_NAME_LEN 16
-#define FS_DATA_LEN 256
+#define FS_DATA_LEN CONFIG_FS_DATA_LEN /* big enough for small native (ELF) programs */
 
 void fs_init(void);
 void fs_format(void);
 int fs_write(const char *name, const char *data);
 int fs_read(const char *name, char *out, int out_sz);
+/* binary-safe variants: write len bytes / read up to max bytes (returns count) */
+int fs_write_buf(const char *name, const void *data, int len);
+int fs_read_buf(const char *name, void *out, int max);
+/* file length in bytes, or -1 */
+int fs_size(const char *name);
 int fs_delete(const char *name);
 void fs_list(void);
 
+typedef struct {
+    int files;
+    unsigned long bytes;     /* file contents */
+    unsigned long allocated; /* FS_DATA_LEN per file in use */
+    unsigned long table;     /* the whole static file table */
+} fs_stats;
+void fs_get_stats(fs_stats *st);
+
 #endif
@@ -0,0 +1,208 @@
+#include "config.h"
+#include "gcov.h"
+
+#if CONFIG_PGO_GEN
+#include "shell.h"
+#include "thread.h"
+#include "uart.h"
+#include "string.h"
+
+/* Freestanding gcov: libgcov wants a C library and files, so, as in other
+   kernels, the compiler's records are walked here and serialized in the
+   .gcda format by hand. -fprofile-info-section puts a pointer to each
+   object's record into .gcov_info (linker.ld) instead of registering it
+   from a constructor. This file is not instrumented itself (Makefile).
+
+   The layouts below are GCC's (libgcov.h) from GCC 12 on, which is also
+   when -fprofile-info-section appeared; GCC 14 added a counter kind. */
+
+#if __GNUC__ < 12
+#error "PGO=gen needs GCC 12 or newer (-fprofile-info-section)"
+#endif
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#else
+#define GCOV_COUNTERS 8
+#endif
+
+#define GCOV_DATA_MAGIC 0x67636461u     /* "gcda" */
+#define GCOV_TAG_FUNCTION 0x01000000u
+#define GCOV_TAG_COUNTER(kind) (0x01a10000u + ((unsigned)(kind) << 17))
+#define GCOV_TAG_OBJECT_SUMMARY 0xa1000000u
+#define GCOV_DUMP_WORDS 16  /* words per line */
+#define GCOV_DUMP_BATCH 64  /* lines between yields while dumping */
+
+typedef long long gcov_type;
+typedef void (*gcov_merge_fn)(gcov_type *, unsigned int);
+
+struct gcov_ctr_info {
+    unsigned int num;
+    gcov_type *values;
+};
+
+struct gcov_info;
+
+struct gcov_fn_info {
+    const struct gcov_info *key; /* the object that owns this copy */
+    unsigned int ident;
+    unsigned int lineno_checksum;
+    unsigned int cfg_checksum;
+    struct gcov_ctr_info ctrs[]; /* one per counter kind in use */
+};
+
+struct gcov_info {
+    unsigned int version;
+    struct gcov_info *next;
+    unsigned int stamp;
+    unsigned int checksum;
+    const char *filename;
+    gcov_merge_fn merge[GCOV_COUNTERS]; /* NULL: kind not used */
+    unsigned int n_functions;
+    const struct gcov_fn_info *const *functions;
+};
+
+extern const struct gcov_info *const __gcov_info_start[];
+extern const struct gcov_info *const __gcov_info_end[];
+
+/* only referenced from the records, for merging into an existing file */
+void __gcov_merge_add(gcov_type *counters, unsigned int n) {
+    (void)counters; (void)n;
+}
+
+static int nwords, nlines;
+
+static void end_line(void) {
+    if (!nwords) return;
+    uart_putc('\n');
+    nwords = 0;
+    /* a long dump must not trip the watchdog */
+    if (++nlines % GCOV_DUMP_BATCH == 0) thread_yield();
+}
+
+/* one 32-bit word of a .gcda image, as 8 hex digits */
+static void put_word(unsigned int w) {
+    if (!nwords) uart_puts("D");
+    uart_putc(' ');
+    for (int sh = 28; sh >= 0; sh -= 4) uart_putc("0123456789abcdef"[(w >> sh) & 0xf]);
+    if (++nwords == GCOV_DUMP_WORDS) end_line();
+}
+
+static void put_tag(unsigned int tag, unsigned int bytes) {
+    put_word(tag);
+    put_word(bytes);
+}
+
+/* functions a COMDAT group shares are kept by one object only */
+static const struct gcov_fn_info *fn_of(const struct gcov_info *info, unsigned int i) {
+    const struct gcov_fn_info *fn = info->functions[i];
+    return fn && fn->key == info ? fn : NULL;
+}
+
+static unsigned long long arcs_max(void) {
+    unsigned long long max = 0;
+    for (const struct gcov_info *const *p = __gcov_info_start; p != __gcov_info_end; ++p) {
+        if (!(*p)->merge[0]) continue;
+        for (unsigned int i = 0; i < (*p)->n_functions; ++i) {
+            const struct gcov_fn_info *fn = fn_of(*p, i);
+            if (!fn) continue;
+            for (unsigned int k = 0; k < fn->ctrs[0].num; ++k) {
+                if ((unsigned long long)fn->ctrs[0].values[k] > max) max = fn->ctrs[0].values[k];
+            }
+        }
+    }
+    return max;
+}
+
+/* the .gcda libgcov would write for one object after one run */
+static void dump_info(const struct gcov_info *info, unsigned long long max) {
+    uart_puts("F ");
+    uart_puts(info->filename);
+    uart_puts("\n");
+    put_word(GCOV_DATA_MAGIC);
+    put_word(info->version);
+    put_word(info->stamp);
+    put_word(info->checksum);
+    put_tag(GCOV_TAG_OBJECT_SUMMARY, 2 * 4);
+    put_word(1); /* runs */
+    put_word(max > 0xffffffffu ? 0xffffffffu : (unsigned int)max);
+    for (unsigned int i = 0; i < info->n_functions; ++i) {
+        const struct gcov_fn_info *fn = fn_of(info, i);
+        put_tag(GCOV_TAG_FUNCTION, fn ? 3 * 4 : 0);
+        if (!fn) continue;
+        put_word(fn->ident);
+        put_word(fn->lineno_checksum);
+        put_word(fn->cfg_checksum);
+        const struct gcov_ctr_info *c = fn->ctrs;
+        for (int kind = 0; kind < GCOV_COUNTERS; ++kind) {
+            if (!info->merge[kind]) continue;
+            put_tag(GCOV_TAG_COUNTER(kind), c->num * 2 * 4);
+            for (unsigned int k = 0; k < c->num; ++k) {
+                unsigned long long v = (unsigned long long)c->values[k];
+                put_word((unsigned int)v);
+                put_word((unsigned int)(v >> 32));
+            }
+            c++;
+        }
+    }
+    put_word(0); /* end of file */
+    end_line();
+}
+
+/* Counters keep moving while the dump runs (the UART driver is counted
+   too); a few stray counts do not matter to the optimizer. */
+static void gcov_dump(void) {
+    unsigned long n = (unsigned long)(__gcov_info_end - __gcov_info_start);
+    unsigned long long max = arcs_max();
+    nwords = nlines = 0;
+    uart_puts("# gcov begin files ");
+    uart_putu(n);
+    uart_puts("\n");
+    for (const struct gcov_info *const *p = __gcov_info_start; p != __gcov_info_end; ++p) {
+        dump_info(*p, max);
+    }
+    uart_puts("# gcov end\n");
+}
+
+/* start counting afresh, e.g. to leave boot out of the profile */
+static void gcov_reset(void) {
+    for (const struct gcov_info *const *p = __gcov_info_start; p != __gcov_info_end; ++p) {
+        for (unsigned int i = 0; i < (*p)->n_functions; ++i) {
+            const struct gcov_fn_info *fn = fn_of(*p, i);
+            if (!fn) continue;
+            const struct gcov_ctr_info *c = fn->ctrs;
+            for (int kind = 0; kind < GCOV_COUNTERS; ++kind) {
+                if (!(*p)->merge[kind]) continue;
+                memset(c->values, 0, c->num * sizeof(gcov_type));
+                c++;
+            }
+        }
+    }
+}
+
+static int gcov_cmd(const char *args) {
+    char word[8];
+    shell_word(&args, word, sizeof(word));
+    if (!strcmp(word, "dump")) {
+        gcov_dump();
+    } else if (!strcmp(word, "reset")) {
+        gcov_reset();
+    } else if (!word[0]) {
+        uart_puts("gcov: ");
+        uart_putu((unsigned long)(__gcov_info_end - __gcov_info_start));
+        uart_puts(" objects counted\n");
+    } else {
+        uart_puts("gcov usage: gcov [dump|reset]\n");
+    }
+    return 0;
+}
+
+void gcov_init(void) {
+    shell_register("gcov", gcov_cmd, "gcov [dump|reset]");
+}
+
+#else
+
+void gcov_init(void) {
+}
+
+#endif /* CONFIG_PGO_GEN */
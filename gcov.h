@@ -0,0 +1,12 @@
+#ifndef GCOV_H
+#define GCOV_H
+
+/* Branch counters for profile-guided builds. A kernel built with PGO=gen
+   counts every arc of its control flow; `gcov dump` prints the counts as
+   .gcda images for pgo.py to write out, and a PGO=use build compiles with
+   them. In other builds gcov_init does nothing. */
+
+/* register the gcov command (PGO=gen builds only) */
+void gcov_init(void);
+
+#endif
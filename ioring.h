@@ -0,0 +1,39 @@
+#ifndef IORING_H
+#define IORING_H
+
+/* Shared-memory submission/completion ring for native programs, shared
+   with user code like syscall.h. SYS_RING_SETUP maps one page holding a
+   struct io_ring into the program; the program queues system calls as
+   SQEs and the kernel answers with CQEs, many per trap (SYS_RING_ENTER) or
+   with no trap at all (IORING_SQPOLL: a kernel thread polls the ring).
+   Only calls that never block are accepted: SYS_WRITE, SYS_FS_READ,
+   SYS_FS_WRITE and SYS_FS_DELETE; anything else completes with -1. */
+
+#define IORING_ENTRIES 32 /* power of two; head/tail run free and wrap */
+
+#define IORING_SQPOLL 0x1 /* SYS_RING_SETUP flag: kernel poller thread */
+
+/* result of a call refused by a quota (the program is not stopped) */
+#define IORING_EQUOTA (-2)
+
+struct io_sqe {
+    unsigned long nr;        /* SYS_* number */
+    unsigned long args[3];   /* as a0..a2 of the ecall */
+    unsigned long user_data; /* copied to the completion */
+};
+
+struct io_cqe {
+    unsigned long user_data;
+    long res;                /* the call's return value */
+};
+
+/* the program writes sq[] and sq_tail and reads cq[] and advances cq_head;
+   the kernel does the opposite */
+struct io_ring {
+    unsigned int sq_head, sq_tail;
+    unsigned int cq_head, cq_tail;
+    struct io_sqe sq[IORING_ENTRIES];
+    struct io_cqe cq[IORING_ENTRIES];
+};
+
+#endif
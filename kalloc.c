@@ -0,0 +1,70 @@
+#include "kalloc.h"
+#include "platform.h"
+#include "string.h"
+#include <stddef.h>
+
+/* Physical page allocator for everything past the kernel image and boot
+   stack. Fresh pages are handed out by bumping a pointer; freed pages go on
+   a singly linked list threaded through the pages themselves. */
+
+extern char _kernel_end[];
+
+typedef struct free_page {
+    struct free_page *next;
+} free_page;
+
+static free_page *free_list;
+static unsigned long next_fresh; /* first never-allocated page */
+static unsigned long nfree;      /* pages on free_list */
+static unsigned long first_page; /* first page of the pool */
+static unsigned long phys_top;   /* end of RAM (platform.c) */
+static kalloc_stats stats;       /* total/free are filled in on demand */
+
+void kalloc_init(void) {
+    phys_top = (platform.ram_base + platform.ram_size) & ~(PAGE_SIZE - 1);
+    first_page = ((unsigned long)_kernel_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    next_fresh = first_page;
+    free_list = NULL;
+    nfree = 0;
+}
+
+void *kalloc_page(int tag) {
+    void *page;
+    if (free_list) {
+        page = free_list;
+        free_list = free_list->next;
+        nfree--;
+    } else if (next_fresh + PAGE_SIZE <= phys_top) {
+        page = (void *)next_fresh;
+        next_fresh += PAGE_SIZE;
+    } else {
+        stats.failed++;
+        return NULL;
+    }
+    stats.allocs++;
+    stats.in_use[tag]++;
+    unsigned long used = (next_fresh - first_page) / PAGE_SIZE - nfree;
+    if (used > stats.peak) stats.peak = used;
+    memset(page, 0, PAGE_SIZE);
+    return page;
+}
+
+void kfree_page(void *page, int tag) {
+    if (!page) return;
+    free_page *f = (free_page *)page;
+    f->next = free_list;
+    free_list = f;
+    nfree++;
+    stats.frees++;
+    stats.in_use[tag]--;
+}
+
+unsigned long kalloc_free_pages(void) {
+    return nfree + (phys_top - next_fresh) / PAGE_SIZE;
+}
+
+void kalloc_get_stats(kalloc_stats *st) {
+    *st = stats;
+    st->total = (phys_top - first_page) / PAGE_SIZE;
+    st->free = kalloc_free_pages();
+}
@@ -0,0 +1,32 @@
+#ifndef KALLOC_H
+#define KALLOC_H
+
+#define PAGE_SIZE 4096UL
+
+/* what a page is for; each tag keeps its own in-use count for `mem` */
+enum {
+    KMEM_PGTABLE, /* page tables (vm.c) */
+    KMEM_USER,    /* pages mapped into program address spaces */
+    KMEM_ELF,     /* native program files held by prog images */
+    KMEM_TAGS
+};
+
+typedef struct {
+    unsigned long total;   /* pages between the kernel image and the end of RAM */
+    unsigned long free;
+    unsigned long peak;    /* most pages in use at once */
+    unsigned long allocs;
+    unsigned long frees;
+    unsigned long failed;  /* allocations refused for lack of memory */
+    unsigned long in_use[KMEM_TAGS];
+} kalloc_stats;
+
+void kalloc_init(void);
+/* one zeroed 4 KiB page, or NULL when memory is exhausted */
+void *kalloc_page(int tag);
+/* tag must be the one the page was allocated with */
+void kfree_page(void *page, int tag);
+unsigned long kalloc_free_pages(void);
+void kalloc_get_stats(kalloc_stats *st);
+
+#endif
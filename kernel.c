@@ -1,210 +1,99 @@
+#include "config.h"
 #include "uart.h"
 #include <stddef.h>
-#include "string.h"
 #include "apps.h"
 #include "fs.h"
 #include "prog.h"
 #include "thread.h"
+#include "kalloc.h"
+#include "vm.h"
+#include "trap.h"
+#include "userbin.h"
+#include "timer.h"
+#include "plic.h"
+#include "console.h"
+#include "shell.h"
+#include "mem.h"
+#include "mbox.h"
+#include "watchdog.h"
+#include "prof.h"
+#include "gcov.h"
+#include "riscv.h"
+#include "platform.h"
 
-/* tiny helpers for command parsing */
-static const char *skip_space(const char *s) {
-    while (*s == ' ') s++;
-    return s;
-}
+typedef struct {
+    const char *name;
+    void (*init)(void);
+} boot_stage;
 
-static int read_word(const char **p, char *out, int max) {
-    const char *s = skip_space(*p);
-    int n = 0;
-    while (*s && *s != ' ' && n + 1 < max) {
-        out[n++] = *s++;
-    }
-    out[n] = '\0';
-    *p = s;
-    return n;
-}
+/* in dependency order: thread_init makes us the idle thread and must come
+   first, kalloc and vm size RAM and map devices from the platform scan, vm
+   needs kalloc, the console needs the PLIC, userbin writes into
+   the FS, and every stage registering shell commands runs before the shell.
+   Only the boot hart runs them: the others are parked (platform.c). */
+static const boot_stage stages[] = {
+    { "thread", thread_init },
+    { "platform", platform_init },
+    { "kalloc", kalloc_init },
+    { "vm", vm_init },
+    { "trap", trap_init },
+    { "timer", timer_init },
+    { "plic", plic_init },
+    { "console", console_init },
+    { "fs", fs_init },
+    { "userbin", userbin_install },
+    { "prog", prog_init },
+    { "mbox", mbox_init },
+    { "apps", apps_init },
+    { "mem", mem_init },
+    { "wdog", wdog_init },
+    { "prof", prof_init },
+    { "gcov", gcov_init },
+    { "shell", shell_start },
+};
 
-static int parse_int(const char *s) {
-    int v = 0;
-    while (*s >= '0' && *s <= '9') {
-        v = v * 10 + (*s - '0');
-        s++;
-    }
-    return v;
-}
+#define NSTAGES (sizeof(stages) / sizeof(stages[0]))
 
-/* scheduler wrapper to guarantee a valid RA when main context is saved */
-__attribute__((noinline))
-static void sched_tick_wrapper(void) {
-    sched_tick();
+static unsigned long usec(unsigned long ticks) {
+    return ticks * 1000000UL / TIMEBASE_HZ;
 }
 
-static void handle_fs(const char *args) {
-    args = skip_space(args);
-    if (!strcmp(args, "ls")) {
-        fs_list();
-        return;
-    }
-    if (!strcmp(args, "format")) {
-        fs_format();
-        uart_puts("fs formatted\n");
-        return;
-    }
-    if (!strncmp(args, "read ", 5)) {
-        char name[32];
-        args += 5;
-        read_word(&args, name, sizeof(name));
-        char buf[128];
-        if (fs_read(name, buf, sizeof(buf)) == 0) {
-            uart_puts(buf);
-            uart_puts("\n");
-        } else {
-            uart_puts("fs read failed\n");
-        }
-        return;
-    }
-    if (!strncmp(args, "write ", 6)) {
-        char name[32];
-        args += 6;
-        read_word(&args, name, sizeof(name));
-        args = skip_space(args);
-        if (fs_write(name, args) == 0) {
-            uart_puts("fs wrote ");
-            uart_puts(name);
-            uart_puts("\n");
-        } else {
-            uart_puts("fs write failed\n");
-        }
-        return;
-    }
-    if (!strncmp(args, "rm ", 3)) {
-        char name[32];
-        args += 3;
-        read_word(&args, name, sizeof(name));
-        if (fs_delete(name) == 0) uart_puts("fs removed\n");
-        else uart_puts("fs rm failed\n");
-        return;
+/* one line per stage; rdtime counts from reset, so the first stamp is
+   the firmware's share */
+static void boot_timeline(const unsigned long *stamp) {
+    uart_puts("[boot] profile " CONFIG_PROFILE);
+    if (CONFIG_PGO[0]) uart_puts(" pgo " CONFIG_PGO);
+    uart_puts("\n");
+    uart_puts("[boot] firmware ");
+    uart_putu(usec(stamp[0]));
+    uart_puts("us\n");
+    for (unsigned long i = 0; i < NSTAGES; ++i) {
+        uart_puts("[boot] ");
+        uart_puts(stages[i].name);
+        uart_puts(" ");
+        uart_putu(usec(stamp[i + 1] - stamp[i]));
+        uart_puts("us\n");
     }
-    uart_puts("fs usage: fs ls|format|read <f>|write <f> <data>|rm <f>\n");
+    uart_puts("[boot] kernel total ");
+    uart_putu(usec(stamp[NSTAGES] - stamp[0]));
+    uart_puts("us\n");
 }
 
-static void handle_prog(const char *args) {
-    args = skip_space(args);
-    if (!strcmp(args, "ls")) { prog_list(); return; }
-    if (!strcmp(args, "runall")) {
-        int started = prog_run_all();
-        if (started < 0) uart_puts("no progs\n");
-        return;
+/* boot: bring up the subsystems (each registers its shell commands), start
+   the shell thread, then become the idle thread */
+void kernel_main(unsigned long hartid, const void *dtb) {
+    unsigned long stamp[NSTAGES + 1];
+    stamp[0] = r_time();
+    platform_boot_args(hartid, dtb);
+    for (unsigned long i = 0; i < NSTAGES; ++i) {
+        stages[i].init();
+        stamp[i + 1] = r_time();
     }
-    if (!strncmp(args, "run ", 4)) {
-        char name[32];
-        args += 4;
-        read_word(&args, name, sizeof(name));
-        if (prog_run(name) < 0) uart_puts("no such prog\n");
-        return;
-    }
-    if (!strncmp(args, "drop ", 5)) {
-        char name[32];
-        args += 5;
-        read_word(&args, name, sizeof(name));
-        if (prog_drop(name) == 0) uart_puts("prog dropped\n");
-        else uart_puts("prog drop failed\n");
-        return;
-    }
-    if (!strncmp(args, "load ", 5)) {
-        char name[32], capsbuf[16];
-        args += 5;
-        read_word(&args, name, sizeof(name));
-        read_word(&args, capsbuf, sizeof(capsbuf));
-        int caps = parse_int(capsbuf);
-        args = skip_space(args);
-        if (prog_load(name, args, caps) == 0) uart_puts("prog loaded\n");
-        else uart_puts("prog load failed\n");
-        return;
-    }
-    if (!strncmp(args, "loadfile ", 9)) {
-        char name[32], capsbuf[16], fname[32];
-        args += 9;
-        read_word(&args, name, sizeof(name));
-        read_word(&args, capsbuf, sizeof(capsbuf));
-        read_word(&args, fname, sizeof(fname));
-        int caps = parse_int(capsbuf);
-        if (prog_load_file(name, fname, caps) == 0) uart_puts("prog loaded from file\n");
-        else uart_puts("prog loadfile failed\n");
-        return;
-    }
-    if (!strncmp(args, "save ", 5)) {
-        char name[32], fname[32];
-        args += 5;
-        read_word(&args, name, sizeof(name));
-        read_word(&args, fname, sizeof(fname));
-        if (prog_save(name, fname) == 0) uart_puts("prog saved\n");
-        else uart_puts("prog save failed\n");
-        return;
-    }
-    uart_puts("prog usage: prog ls|runall|load <name> <caps> <script>|loadfile <name> <caps> <file>|run <name>|drop <name>|save <name> <file>\n");
-}
-
-/* tiny shell: ... */
-void kernel_main(void) {
-    fs_init();
-    prog_init();
-    uart_puts("tiny-shell: type 'help' or 'stop'\n");
-    char buf[80];
-    int pos = 0;
-    uart_puts("$ ");
+    boot_timeline(stamp);
+    /* idle loop: run whatever is ready, otherwise wfi until the next
+       sleeper's deadline or a UART interrupt */
     for (;;) {
-        /* allow scheduler to run background threads */
-
-    	if (!uart_haschar()) {
-	    sched_tick_wrapper();
-	}
-        int c = uart_getc();
-        if (c == '\r') c = '\n';
-        if (c == '\n') {
-            uart_puts("\n");
-            buf[pos] = '\0';
-            if (pos > 0) {
-                if (!strcmp(buf, "help")) {
-                    uart_puts("commands: help stop ls run <app> ps kill <tid>\n");
-                    uart_puts("          fs ... (ls/read/write/rm/format)\n");
-                    uart_puts("          prog ... (ls/runall/load/loadfile/save/run/drop)\n");
-                } else if (!strncmp(buf, "run ", 4)) {
-                    const char *name = buf + 4;
-                    if (app_spawn(name) < 0) {
-                        uart_puts("no such app\n");
-                    }
-                } else if (!strcmp(buf, "ls") || !strcmp(buf, "apps")) {
-                    app_list();
-                } else if (!strcmp(buf, "ps")) {
-                    thread_list();
-                } else if (!strncmp(buf, "fs ", 3)) {
-                    handle_fs(buf + 3);
-                } else if (!strncmp(buf, "prog ", 5)) {
-                    handle_prog(buf + 5);
-                } else if (!strncmp(buf, "kill ", 5)) {
-                    const char *s = buf + 5;
-                    int tid = 0;
-                    while (*s >= '0' && *s <= '9') { tid = tid*10 + (*s - '0'); s++; }
-                    if (thread_kill(tid) < 0) uart_puts("no such tid\n");
-                } else if (!strcmp(buf, "stop")) {
-                    uart_puts("stopping kernel — halting now.\n");
-                    while (1) { asm volatile("wfi"); }
-                } else {
-                    uart_puts("unknown\n");
-                }
-            }
-            pos = 0;
-            uart_puts("$ ");
-        } else if (c == 8 || c == 127) { // backspace
-            if (pos > 0) {
-                pos--;
-                uart_puts("\b \b");
-            }
-        } else {
-            if (pos < (int)sizeof(buf)-1) {
-                buf[pos++] = (char)c;
-                uart_putc((char)c);
-            }
-        }
+        sched_tick();
+        thread_idle();
     }
 }
@@ -0,0 +1,237 @@
+#include "mbox.h"
+#include "thread.h"
+#include "shell.h"
+#include "string.h"
+#include "uart.h"
+#include <stddef.h>
+
+/* Each mailbox is a ring of message pointers. Receivers block on the ring's
+   head and senders on its tail; kernel threads only switch at those calls,
+   so checking and blocking need no lock. gen tells a woken waiter that its
+   mailbox was destroyed (and maybe recreated) meanwhile. */
+
+typedef struct {
+    int used;
+    unsigned int gen;
+    char name[MBOX_NAME];
+    int depth;
+    int refs;      /* mbox_open references */
+    int counted;   /* created by mbox_open: destroyed with its last reference */
+    unsigned int head, tail; /* tail - head messages queued */
+    mbox_msg *q[MBOX_DEPTH];
+    unsigned long sent, received;
+} mbox;
+
+static mbox boxes[MBOX_MAX];
+static mbox_msg pool[MBOX_POOL];
+static mbox_msg *free_msgs[MBOX_POOL]; /* stack of unused buffers */
+static int nfree;
+
+static mbox *box_get(int id) {
+    if (id < 0 || id >= MBOX_MAX || !boxes[id].used) return NULL;
+    return &boxes[id];
+}
+
+mbox_msg *mbox_msg_alloc(void) {
+    if (nfree == 0) return NULL;
+    mbox_msg *m = free_msgs[--nfree];
+    m->len = 0;
+    return m;
+}
+
+void mbox_msg_free(mbox_msg *m) {
+    if (m) free_msgs[nfree++] = m;
+}
+
+int mbox_find(const char *name) {
+    for (int i = 0; i < MBOX_MAX; ++i) {
+        if (boxes[i].used && !strcmp(boxes[i].name, name)) return i;
+    }
+    return -1;
+}
+
+int mbox_create(const char *name, int depth) {
+    int id = mbox_find(name);
+    if (id >= 0) {
+        boxes[id].counted = 0; /* someone wants it kept */
+        return id;
+    }
+    if (!name[0] || strlen(name) >= MBOX_NAME) return -1;
+    if (depth <= 0 || depth > MBOX_DEPTH) depth = MBOX_DEPTH;
+    for (int i = 0; i < MBOX_MAX; ++i) {
+        mbox *b = &boxes[i];
+        if (b->used) continue;
+        unsigned int gen = b->gen;
+        memset(b, 0, sizeof(*b));
+        b->used = 1;
+        b->gen = gen + 1;
+        strlcpy(b->name, name, sizeof(b->name));
+        b->depth = depth;
+        return i;
+    }
+    return -1;
+}
+
+int mbox_destroy(int id) {
+    mbox *b = box_get(id);
+    if (!b) return -1;
+    while (b->head != b->tail) mbox_msg_free(b->q[b->head++ % MBOX_DEPTH]);
+    b->used = 0;
+    b->gen++;
+    thread_wake(&b->head);
+    thread_wake(&b->tail);
+    return 0;
+}
+
+int mbox_open(const char *name, unsigned int *gen) {
+    int id = mbox_find(name);
+    if (id < 0) {
+        if ((id = mbox_create(name, 0)) < 0) return -1;
+        boxes[id].counted = 1;
+    }
+    boxes[id].refs++;
+    *gen = boxes[id].gen;
+    return id;
+}
+
+int mbox_live(int id, unsigned int gen) {
+    mbox *b = box_get(id);
+    return b && b->gen == gen ? id : -1;
+}
+
+void mbox_close(int id, unsigned int gen) {
+    if (mbox_live(id, gen) < 0) return; /* removed meanwhile */
+    mbox *b = &boxes[id];
+    if (--b->refs == 0 && b->counted) mbox_destroy(id);
+}
+
+int mbox_post(int id, mbox_msg **msgs, int n, int block) {
+    mbox *b = box_get(id);
+    if (!b) return -1;
+    unsigned int gen = b->gen;
+    int done = 0;
+    while (done < n) {
+        while (done < n && b->tail - b->head < (unsigned int)b->depth) {
+            b->q[b->tail++ % MBOX_DEPTH] = msgs[done++];
+        }
+        if (done == n || !block) break;
+        /* full: let the receivers drain what is queued so far */
+        thread_wake(&b->head);
+        thread_block(&b->tail);
+        if (!b->used || b->gen != gen) return done ? done : -1;
+    }
+    b->sent += (unsigned long)done;
+    if (done) thread_wake(&b->head);
+    return done;
+}
+
+mbox_msg *mbox_take(int id, int block) {
+    mbox *b = box_get(id);
+    if (!b) return NULL;
+    unsigned int gen = b->gen;
+    while (b->head == b->tail) {
+        if (!block) return NULL;
+        thread_block(&b->head);
+        if (!b->used || b->gen != gen) return NULL;
+    }
+    mbox_msg *m = b->q[b->head++ % MBOX_DEPTH];
+    b->received++;
+    thread_wake(&b->tail);
+    return m;
+}
+
+int mbox_send(int id, const void *data, int len) {
+    mbox *b = box_get(id);
+    if (!b) return -1;
+    unsigned int gen = b->gen;
+    /* block before taking a buffer: a kill takes effect while blocked */
+    while (b->tail - b->head >= (unsigned int)b->depth) {
+        thread_wake(&b->head);
+        thread_block(&b->tail);
+        if (!b->used || b->gen != gen) return -1;
+    }
+    mbox_msg *m = mbox_msg_alloc();
+    if (!m) return -1;
+    if (len > MBOX_MSG) len = MBOX_MSG;
+    memcpy(m->data, data, (unsigned long)len);
+    m->len = len;
+    if (mbox_post(id, &m, 1, 0) != 1) {
+        mbox_msg_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+int mbox_recv(int id, void *out, int max) {
+    mbox_msg *m = mbox_take(id, 1);
+    if (!m) return -1;
+    int len = m->len < max ? m->len : max;
+    memcpy(out, m->data, (unsigned long)len);
+    mbox_msg_free(m);
+    return len;
+}
+
+static void mbox_list(void) {
+    uart_puts("mailboxes:\n");
+    for (int i = 0; i < MBOX_MAX; ++i) {
+        mbox *b = &boxes[i];
+        if (!b->used) continue;
+        uart_puts(" - ");
+        uart_puts(b->name);
+        uart_puts(" queued:");
+        uart_putu(b->tail - b->head);
+        uart_puts("/");
+        uart_putu((unsigned long)b->depth);
+        uart_puts(" sent:");
+        uart_putu(b->sent);
+        uart_puts(" received:");
+        uart_putu(b->received);
+        if (b->refs) {
+            uart_puts(" open:");
+            uart_putu((unsigned long)b->refs);
+        }
+        uart_puts("\n");
+    }
+    uart_puts(" free buffers:");
+    uart_putu((unsigned long)nfree);
+    uart_puts("\n");
+}
+
+static int mbox_cmd(const char *args) {
+    char verb[8], name[MBOX_NAME + 1];
+    shell_word(&args, verb, sizeof(verb));
+    if (!strcmp(verb, "ls")) {
+        mbox_list();
+        return 0;
+    }
+    if (!shell_word(&args, name, sizeof(name))) {
+        uart_puts("mbox usage: mbox ls|create <name> [depth]|send <name> <text>|recv <name>|rm <name>\n");
+        return 0;
+    }
+    if (!strcmp(verb, "create")) {
+        if (mbox_create(name, shell_int(shell_skip(args))) < 0) uart_puts("mbox: bad name or table full\n");
+    } else if (!strcmp(verb, "send")) {
+        const char *text = shell_skip(args);
+        if (mbox_send(mbox_find(name), text, (int)strlen(text)) < 0) uart_puts("mbox: no such mailbox or no buffers\n");
+    } else if (!strcmp(verb, "recv")) {
+        /* the shell must not block on an idle mailbox */
+        mbox_msg *m = mbox_take(mbox_find(name), 0);
+        if (!m) {
+            uart_puts("mbox: empty\n");
+            return 0;
+        }
+        for (int i = 0; i < m->len; ++i) uart_putc(m->data[i]);
+        uart_puts("\n");
+        mbox_msg_free(m);
+    } else if (!strcmp(verb, "rm")) {
+        if (mbox_destroy(mbox_find(name)) < 0) uart_puts("mbox: no such mailbox\n");
+    } else {
+        uart_puts("mbox: unknown command\n");
+    }
+    return 0;
+}
+
+void mbox_init(void) {
+    for (nfree = 0; nfree < MBOX_POOL; ++nfree) free_msgs[nfree] = &pool[nfree];
+    shell_register("mbox", mbox_cmd, "mbox ls|create|send|recv|rm");
+}
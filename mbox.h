@@ -0,0 +1,64 @@
+#ifndef MBOX_H
+#define MBOX_H
+
+/* Named mailboxes: bounded queues of messages between threads (apps,
+   prog scripts). Messages live in a shared pool of fixed-size buffers and
+   only pointers move through the queues, so mbox_post/mbox_take hand a
+   buffer from sender to receiver without copying it. mbox_send and
+   mbox_recv are the copying convenience forms. */
+
+#define MBOX_MAX 8
+#define MBOX_NAME 16
+#define MBOX_DEPTH 16  /* most messages a mailbox queues */
+#define MBOX_POOL 64   /* message buffers shared by all mailboxes */
+#define MBOX_MSG 64    /* bytes per message */
+
+typedef struct {
+    int len;
+    char data[MBOX_MSG];
+} mbox_msg;
+
+/* fill the buffer pool and register the mbox shell command */
+void mbox_init(void);
+
+/* create a mailbox holding up to depth messages (0 = MBOX_DEPTH); returns
+   its id, the existing id if the name is taken, or -1 */
+int mbox_create(const char *name, int depth);
+/* id by name, or -1 */
+int mbox_find(const char *name);
+/* wakes all waiters, which then fail; queued messages are freed */
+int mbox_destroy(int id);
+
+/* Counted use, for prog scripts: mbox_open takes a reference to the named
+   mailbox, creating it if needed, and sets *gen to tell this mailbox from
+   a later one in the same slot; returns its id or -1. A mailbox open
+   created goes away with its last mbox_close, unless mbox_create claimed
+   it meanwhile. */
+int mbox_open(const char *name, unsigned int *gen);
+void mbox_close(int id, unsigned int gen);
+/* id if it still names the mailbox opened as gen, else -1 */
+int mbox_live(int id, unsigned int gen);
+
+/* a buffer from the pool (NULL if it is empty); the receiver of a
+   message, or whoever gives up sending it, frees it */
+mbox_msg *mbox_msg_alloc(void);
+void mbox_msg_free(mbox_msg *m);
+
+/* queue n messages in order, blocking while the mailbox is full if block
+   is set; returns how many were queued (ownership passes for those), or -1
+   if the mailbox is gone. Receivers are woken once per call, not per
+   message. */
+int mbox_post(int id, mbox_msg **msgs, int n, int block);
+/* next message (the caller owns it), blocking while empty if block is
+   set; NULL if none or the mailbox is gone */
+mbox_msg *mbox_take(int id, int block);
+
+/* copy len bytes into a pooled buffer and post it (blocking); returns 0 or
+   -1 if the pool is empty or the mailbox is gone. It waits for room before
+   taking the buffer, so a sender killed while blocked holds none. */
+int mbox_send(int id, const void *data, int len);
+/* take a message (blocking), copy up to max bytes to out and free it;
+   returns the length or -1 */
+int mbox_recv(int id, void *out, int max);
+
+#endif
@@ -0,0 +1,120 @@
+#include "mem.h"
+#include "kalloc.h"
+#include "thread.h"
+#include "fs.h"
+#include "prog.h"
+#include "prof.h"
+#include "shell.h"
+#include "uart.h"
+
+/* linker.ld */
+extern char _image_start[], _text_end[], _rodata_end[], __bss_start[], __bss_end[];
+extern char _stack_bottom[], _stack_top[];
+
+#define MEM_ROWS 16 /* thread and image rows per report */
+
+/* static rather than on the caller's 4 KiB stack; output never yields */
+static thread_stack_stat stack_rows[MEM_ROWS];
+static prog_image_stat image_rows[MEM_ROWS];
+
+/* " <label> <v>" */
+static void field(const char *label, unsigned long v) {
+    uart_puts(" ");
+    uart_puts(label);
+    uart_puts(" ");
+    uart_putu(v);
+}
+
+static void report_pages(void) {
+    kalloc_stats ks;
+    kalloc_get_stats(&ks);
+    uart_puts("pages:");
+    field("total", ks.total);
+    field("free", ks.free);
+    field("used", ks.total - ks.free);
+    field("peak", ks.peak);
+    field("allocs", ks.allocs);
+    field("frees", ks.frees);
+    field("failed", ks.failed);
+    uart_puts("\n ");
+    field("pgtable", ks.in_use[KMEM_PGTABLE]);
+    field("user", ks.in_use[KMEM_USER]);
+    field("elf", ks.in_use[KMEM_ELF]);
+    uart_puts("\n");
+}
+
+static void report_image(void) {
+    uart_puts("image (bytes):");
+    field("text", (unsigned long)(_text_end - _image_start));
+    field("rodata", (unsigned long)(_rodata_end - _text_end));
+    field("data", (unsigned long)(__bss_start - _rodata_end));
+    field("bss", (unsigned long)(__bss_end - __bss_start));
+    field("boot-stack", (unsigned long)(_stack_top - _stack_bottom));
+    uart_puts("\n  static tables:");
+    field("threads", thread_static_bytes());
+    field("prog", prog_static_bytes());
+    field("prof", prof_static_bytes());
+    uart_puts("\n");
+}
+
+static void report_stacks(void) {
+    thread_stack_stat *st = stack_rows;
+    int n = thread_stack_stats(st, MEM_ROWS);
+    uart_puts("stacks (peak/size):\n");
+    for (int i = 0; i < n; ++i) {
+        uart_puts("  ");
+        uart_putu((unsigned long)st[i].tid);
+        uart_puts(" ");
+        uart_puts(st[i].name);
+        uart_puts(" ");
+        uart_putu(st[i].stack_peak);
+        uart_puts("/");
+        uart_putu(st[i].stack_size);
+        /* a quarter left is the point to look at STACK_SIZE */
+        if (st[i].stack_peak * 4 >= st[i].stack_size * 3) uart_puts(" (near full)");
+        uart_puts("\n");
+    }
+}
+
+static void report_fs(void) {
+    fs_stats fst;
+    fs_get_stats(&fst);
+    uart_puts("fs:");
+    field("files", (unsigned long)fst.files);
+    field("bytes", fst.bytes);
+    field("allocated", fst.allocated);
+    field("table", fst.table);
+    uart_puts("\n");
+}
+
+static void report_progs(void) {
+    prog_image_stat *st = image_rows;
+    int n = prog_image_stats(st, MEM_ROWS);
+    uart_puts("prog images:\n");
+    for (int i = 0; i < n; ++i) {
+        uart_puts("  ");
+        uart_puts(st[i].name);
+        field("code", st[i].code);
+        field("elf", st[i].elf);
+        field("refs", (unsigned long)st[i].refs);
+        uart_puts("\n");
+    }
+}
+
+void mem_report(void) {
+    report_pages();
+    report_image();
+    report_stacks();
+    report_fs();
+    report_progs();
+}
+
+static int mem_cmd(const char *args) {
+    (void)args;
+    mem_report();
+    return 0;
+}
+
+void mem_init(void) {
+    shell_register("mem", mem_cmd, "mem");
+}
@@ -0,0 +1,12 @@
+#ifndef MEM_H
+#define MEM_H
+
+/* Memory report: pulls the counters kept by kalloc, thread, fs and prog
+   (each has its own *_stats call) into the `mem` shell command. */
+
+/* register the mem command */
+void mem_init(void);
+/* print the report */
+void mem_report(void);
+
+#endif
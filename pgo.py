@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Profile-guided builds from QEMU runs, and build-to-build comparisons.
+
+    make PROFILE=bench && ./runqemu.sh | tee base.log             # run bench
+    make PROFILE=bench-lto PGO=gen && ./runqemu.sh | tee gen.log
+        # in the shell: gcov reset; run bench; gcov dump
+    ./pgo.py gcda gen.log            # writes <object>.gcda next to the objects
+    make PROFILE=bench-lto PGO=use BENCH_BASE=base.log && ./runqemu.sh | tee pgo.log
+        # run bench: prints the speedup over base.log itself
+    ./pgo.py compare base.log pgo.log
+
+`gcda` decodes the last `gcov dump` in a console log into .gcda files, one
+per kernel object. They go into --dir (default: this directory) under the
+name the compiler recorded, so the PGO=use build finds them. `compare`
+reads the `[bench]` lines of two logs and prints the time of each case and
+the speedup of the second build over the first. `base` prints the results
+of one log as `case=us ...` for the Makefile (BENCH_BASE), which builds them
+into the kernel so `run bench` reports the speedup itself.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def read_dump(lines):
+    """(filename, words) per object of the last dump."""
+    files, cur, seen = [], None, False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# gcov begin"):
+            files, cur, seen = [], None, True
+        elif not seen:
+            continue
+        elif line.startswith("F "):
+            cur = (line[2:], [])
+            files.append(cur)
+        elif line.startswith("D ") and cur:
+            cur[1].extend(int(w, 16) for w in line.split()[1:])
+        elif line.startswith("# gcov end"):
+            return files
+    sys.exit("pgo: no complete '# gcov begin' .. '# gcov end' in the log")
+
+
+def cmd_gcda(args):
+    with (open(args.log, errors="replace") if args.log else sys.stdin) as f:
+        files = read_dump(f)
+    for name, words in files:
+        path = os.path.join(args.dir, os.path.basename(name))
+        with open(path, "wb") as out:
+            out.write(struct.pack("<%dI" % len(words), *words))
+        print("%s: %d bytes" % (path, 4 * len(words)))
+
+
+BENCH = re.compile(r"\[bench\] (\S+) (\d+) us")
+
+
+def read_bench(path):
+    """{case: us} from the last run of the suite in a log."""
+    times = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            if "[bench] begin" in line:
+                times = {}
+            m = BENCH.search(line)
+            if m:
+                times[m.group(1)] = int(m.group(2))
+    if not times:
+        sys.exit("pgo: no [bench] results in %s" % path)
+    return times
+
+
+def cmd_compare(args):
+    base, new = read_bench(args.base), read_bench(args.new)
+    print("%-10s %10s %10s %8s" % ("case", "base us", "new us", "speedup"))
+    for case in base:
+        if case not in new:
+            continue
+        b, n = base[case], new[case]
+        print("%-10s %10d %10d %7.2fx" % (case, b, n, b / n if n else float("inf")))
+
+
+def cmd_base(args):
+    print(" ".join("%s=%d" % (case, us) for case, us in read_bench(args.log).items()))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    g = sub.add_parser("gcda", help="write .gcda files from a gcov dump")
+    g.add_argument("log", nargs="?", help="console log with a gcov dump (default: stdin)")
+    g.add_argument("--dir", default=HERE, help="where the kernel objects are (default: %(default)s)")
+    c = sub.add_parser("compare", help="compare the bench results of two builds")
+    c.add_argument("base", help="console log of the baseline build")
+    c.add_argument("new", help="console log of the build to compare")
+    b = sub.add_parser("base", help="print bench results as case=us for BENCH_BASE")
+    b.add_argument("log", help="console log of the baseline build")
+    args = ap.parse_args()
+    if args.cmd == "gcda":
+        cmd_gcda(args)
+    elif args.cmd == "base":
+        cmd_base(args)
+    else:
+        cmd_compare(args)
+
+
+if __name__ == "__main__":
+    main()
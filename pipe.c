@@ -0,0 +1,83 @@
+#include "pipe.h"
+#include "thread.h"
+
+/* Byte rings; readers block on the ring's head, writers on its tail.
+   Kernel threads only switch inside those calls, so no lock is needed. */
+
+typedef struct {
+    int readers, writers; /* open ends; the slot is free when both are 0 */
+    unsigned int head, tail;
+    char buf[PIPE_BUF];
+} pipe_t;
+
+static pipe_t pipes[PIPE_MAX];
+
+static pipe_t *pipe_get(int id) {
+    if (id < 0 || id >= PIPE_MAX) return 0;
+    pipe_t *p = &pipes[id];
+    return (p->readers || p->writers) ? p : 0;
+}
+
+int pipe_create(void) {
+    for (int i = 0; i < PIPE_MAX; ++i) {
+        pipe_t *p = &pipes[i];
+        if (p->readers || p->writers) continue;
+        p->readers = p->writers = 1;
+        p->head = p->tail = 0;
+        return i;
+    }
+    return -1;
+}
+
+void pipe_close_read(int id) {
+    pipe_t *p = pipe_get(id);
+    if (!p || !p->readers) return;
+    if (--p->readers == 0) thread_wake(&p->tail); /* writers fail now */
+}
+
+void pipe_close_write(int id) {
+    pipe_t *p = pipe_get(id);
+    if (!p || !p->writers) return;
+    if (--p->writers == 0) thread_wake(&p->head); /* readers hit EOF */
+}
+
+int pipe_write(int id, const void *buf, int len) {
+    pipe_t *p = pipe_get(id);
+    const char *s = buf;
+    if (!p) return -1;
+    for (int n = 0; n < len;) {
+        if (!p->readers) return -1;
+        if (p->tail - p->head == PIPE_BUF) {
+            thread_wake(&p->head);
+            thread_block(&p->tail);
+            continue;
+        }
+        p->buf[p->tail++ % PIPE_BUF] = s[n++];
+    }
+    thread_wake(&p->head);
+    return len;
+}
+
+int pipe_read_line(int id, char *out, int max) {
+    pipe_t *p = pipe_get(id);
+    int n = 0;
+    if (!p) return -1;
+    for (;;) {
+        if (p->head == p->tail) {
+            if (!p->writers) break;
+            thread_wake(&p->tail);
+            thread_block(&p->head);
+            continue;
+        }
+        char c = p->buf[p->head++ % PIPE_BUF];
+        if (c == '\n') {
+            out[n] = '\0';
+            thread_wake(&p->tail);
+            return n;
+        }
+        if (n + 1 < max) out[n++] = c;
+    }
+    /* EOF: a last line without '\n' still counts */
+    out[n] = '\0';
+    return n ? n : -1;
+}
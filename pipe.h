@@ -0,0 +1,25 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+/* Pipes: bounded in-kernel byte streams joining shell pipeline stages.
+   Readers block while a pipe is empty and writers while it is full. Each
+   end is reference-counted; when the last writer closes, readers drain
+   what is left and then see end of file. When the last reader closes,
+   writes fail. */
+
+#define PIPE_MAX 8
+#define PIPE_BUF 256
+
+/* a new pipe with one read and one write reference; returns its id or -1 */
+int pipe_create(void);
+void pipe_close_read(int id);
+void pipe_close_write(int id);
+/* write all len bytes, blocking while full; returns len, or -1 once no
+   reader is left */
+int pipe_write(int id, const void *buf, int len);
+/* one line without its '\n' (cut at max - 1 bytes, NUL-terminated),
+   blocking until it is complete; returns its length, or -1 at end of file
+   with nothing read */
+int pipe_read_line(int id, char *out, int max);
+
+#endif
@@ -0,0 +1,249 @@
+#include "platform.h"
+#include "sbi.h"
+#include "riscv.h"
+#include "string.h"
+#include "uart.h"
+#include <stddef.h>
+
+platform_info platform = {
+    .ram_base = 0x80000000UL,
+    .ram_size = 128UL * 1024 * 1024,
+    .nharts = 1,
+    .uart = { 0x10000000UL, 0x100 },
+    .plic = { 0x0c000000UL, 0x600000 },
+    .clint = { 0x02000000UL, 0x10000 },
+    .uart_irq = 10,
+    .nvirtio = 8,
+    .virtio = {
+        { 0x10001000UL, 0x1000 }, { 0x10002000UL, 0x1000 },
+        { 0x10003000UL, 0x1000 }, { 0x10004000UL, 0x1000 },
+        { 0x10005000UL, 0x1000 }, { 0x10006000UL, 0x1000 },
+        { 0x10007000UL, 0x1000 }, { 0x10008000UL, 0x1000 },
+    },
+};
+
+static const unsigned char *dtb;
+
+/* FDT format (devicetree spec, chapter 5): a header, then a structure
+   block of big-endian tokens and a strings block for property names */
+#define FDT_MAGIC 0xd00dfeedU
+#define FDT_BEGIN_NODE 1
+#define FDT_END_NODE 2
+#define FDT_PROP 3
+#define FDT_NOP 4
+#define FDT_END 9
+#define FDT_DEPTH 8
+
+#define SBI_EXT_HSM 0x48534D
+#define SBI_HSM_HART_START 0
+#define HART_STACK 1024 /* a parked hart only runs hart_park */
+
+/* the node being read at each depth; children use its cells */
+typedef struct {
+    int addr_cells, size_cells;
+    const char *compat;
+    int compat_len;
+    const char *dev_type;
+    const char *status;
+    const unsigned char *reg;
+    int reg_len;
+    int irq;
+} fdt_node;
+
+static unsigned char hart_stacks[PLATFORM_MAX_HARTS][HART_STACK] __attribute__((aligned(16)));
+static volatile int hart_up[PLATFORM_MAX_HARTS];
+
+extern void _secondary(void); /* entry.S */
+
+static unsigned int be32(const unsigned char *p) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+           ((unsigned int)p[2] << 8) | p[3];
+}
+
+/* an n-cell number (n = 1 or 2) */
+static unsigned long cells(const unsigned char *p, int n) {
+    unsigned long v = 0;
+    while (n-- > 0) {
+        v = (v << 32) | be32(p);
+        p += 4;
+    }
+    return v;
+}
+
+/* compatible is a list of NUL-terminated strings */
+static int has_compat(const fdt_node *n, const char *want) {
+    for (int off = 0; off < n->compat_len; off += (int)strlen(n->compat + off) + 1) {
+        if (!strcmp(n->compat + off, want)) return 1;
+    }
+    return 0;
+}
+
+/* first (address, size) pair of reg, in the parent's cells */
+static int first_reg(const fdt_node *n, const fdt_node *parent, mmio_range *r) {
+    int len = 4 * (parent->addr_cells + parent->size_cells);
+    if (!n->reg || n->reg_len < len || parent->addr_cells > 2 || parent->size_cells > 2) return -1;
+    r->base = cells(n->reg, parent->addr_cells);
+    r->size = cells(n->reg + 4 * parent->addr_cells, parent->size_cells);
+    return 0;
+}
+
+static void node_done(const fdt_node *n, const fdt_node *parent) {
+    mmio_range r;
+    if (n->status && strcmp(n->status, "okay") && strcmp(n->status, "ok")) return;
+    if (first_reg(n, parent, &r) < 0) return;
+    if (n->dev_type && !strcmp(n->dev_type, "memory")) {
+        /* the bank we run from is the one below any other */
+        if (!platform.ram_size || r.base < platform.ram_base) {
+            platform.ram_base = r.base;
+            platform.ram_size = r.size;
+        }
+    } else if (n->dev_type && !strcmp(n->dev_type, "cpu")) {
+        /* cpu reg is the hart id; the cpus node has #size-cells = 0 */
+        if (platform.nharts < PLATFORM_MAX_HARTS) platform.harts[platform.nharts++] = r.base;
+    } else if (has_compat(n, "ns16550a") || has_compat(n, "ns16550")) {
+        if (!platform.uart.base) {
+            platform.uart = r;
+            if (n->irq > 0) platform.uart_irq = n->irq;
+        }
+    } else if (has_compat(n, "riscv,plic0") || has_compat(n, "sifive,plic-1.0.0")) {
+        platform.plic = r;
+    } else if (has_compat(n, "riscv,clint0") || has_compat(n, "sifive,clint0")) {
+        platform.clint = r;
+    } else if (has_compat(n, "virtio,mmio")) {
+        if (platform.nvirtio < PLATFORM_MAX_VIRTIO) platform.virtio[platform.nvirtio++] = r;
+    }
+}
+
+/* walk the structure block; returns 0 if the blob was usable */
+static int fdt_scan(const unsigned char *blob) {
+    if (!blob || be32(blob) != FDT_MAGIC) return -1;
+    const unsigned char *p = blob + be32(blob + 8);
+    const unsigned char *end = p + be32(blob + 36);
+    const char *strings = (const char *)blob + be32(blob + 12);
+    fdt_node stack[FDT_DEPTH];
+    int depth = -1, done = 0;
+
+    /* what the blob describes replaces the defaults; RAM goes by address */
+    platform_info saved = platform;
+    platform.ram_size = 0;
+    platform.nharts = 0;
+    platform.uart.base = 0;
+    platform.nvirtio = 0;
+
+    while (p + 4 <= end) {
+        unsigned int tok = be32(p);
+        p += 4;
+        if (tok == FDT_BEGIN_NODE) {
+            p += (strlen((const char *)p) + 4) & ~3UL; /* name, padded */
+            if (++depth >= FDT_DEPTH) break;
+            fdt_node *n = &stack[depth];
+            memset(n, 0, sizeof(*n));
+            /* spec defaults for a node that doesn't say */
+            n->addr_cells = 2;
+            n->size_cells = 1;
+        } else if (tok == FDT_END_NODE) {
+            if (depth < 0) break;
+            if (depth > 0) node_done(&stack[depth], &stack[depth - 1]);
+            depth--;
+        } else if (tok == FDT_PROP) {
+            unsigned int len = be32(p);
+            const char *name = strings + be32(p + 4);
+            const unsigned char *val = p + 8;
+            p = val + ((len + 3) & ~3U);
+            if (depth < 0) break;
+            fdt_node *n = &stack[depth];
+            if (!strcmp(name, "#address-cells")) n->addr_cells = (int)be32(val);
+            else if (!strcmp(name, "#size-cells")) n->size_cells = (int)be32(val);
+            else if (!strcmp(name, "compatible")) { n->compat = (const char *)val; n->compat_len = (int)len; }
+            else if (!strcmp(name, "device_type")) n->dev_type = (const char *)val;
+            else if (!strcmp(name, "status")) n->status = (const char *)val;
+            else if (!strcmp(name, "reg")) { n->reg = val; n->reg_len = (int)len; }
+            else if (!strcmp(name, "interrupts") && len >= 4) n->irq = (int)be32(val);
+        } else if (tok == FDT_END) {
+            done = 1;
+            break;
+        } else if (tok != FDT_NOP) {
+            break;
+        }
+    }
+    if (!done || depth != -1 || !platform.ram_size) {
+        platform = saved;
+        return -1;
+    }
+    /* keep the defaults for whatever the blob left out */
+    if (!platform.nharts) platform.harts[platform.nharts++] = platform.boot_hart;
+    if (!platform.uart.base) {
+        platform.uart = saved.uart;
+        platform.uart_irq = saved.uart_irq;
+    }
+    return 0;
+}
+
+void platform_boot_args(unsigned long hartid, const void *blob) {
+    platform.boot_hart = hartid;
+    platform.harts[0] = hartid;
+    dtb = blob;
+}
+
+void hart_park(unsigned long hartid);
+
+/* secondary harts land here from _secondary (entry.S) on their own stack.
+   The scheduler and the subsystems under it assume one hart, so these
+   stay parked with interrupts off instead of running threads. */
+void hart_park(unsigned long hartid) {
+    for (int i = 0; i < platform.nharts; ++i) {
+        if (platform.harts[i] == hartid) hart_up[i] = 1;
+    }
+    __sync_synchronize();
+    for (;;) wfi();
+}
+
+/* SBI HSM hart_start for every hart but ours; returns how many came up */
+static int start_harts(void) {
+    if (platform.nharts < 2 || !sbi_probe(SBI_EXT_HSM)) return 0;
+    for (int i = 0; i < platform.nharts; ++i) {
+        if (platform.harts[i] == platform.boot_hart) continue;
+        sbi_call(SBI_EXT_HSM, SBI_HSM_HART_START, (long)platform.harts[i],
+                 (long)_secondary, (long)&hart_stacks[i][HART_STACK]);
+    }
+    /* wait for them to check in, but not forever */
+    unsigned long until = r_time() + TIMEBASE_HZ / 100;
+    int up;
+    do {
+        up = 0;
+        __sync_synchronize();
+        for (int i = 0; i < platform.nharts; ++i) up += hart_up[i];
+    } while (up < platform.nharts - 1 && r_time() < until);
+    return up;
+}
+
+void platform_init(void) {
+    platform.from_fdt = fdt_scan(dtb) == 0;
+    if (!platform.from_fdt) {
+        platform.nharts = 1;
+        platform.harts[0] = platform.boot_hart;
+    }
+    platform.parked = start_harts();
+
+    uart_puts(platform.from_fdt ? "[platform] fdt: " : "[platform] no fdt, QEMU virt defaults: ");
+    uart_putu(platform.ram_size >> 20);
+    uart_puts(" MiB RAM at ");
+    uart_puthex(platform.ram_base);
+    uart_puts(", ");
+    uart_putu((unsigned long)platform.nharts);
+    uart_puts(" harts (boot hart ");
+    uart_putu(platform.boot_hart);
+    uart_puts(", ");
+    uart_putu((unsigned long)platform.parked);
+    uart_puts(" parked)\n[platform] uart ");
+    uart_puthex(platform.uart.base);
+    uart_puts(" irq ");
+    uart_putu((unsigned long)platform.uart_irq);
+    uart_puts(", plic ");
+    uart_puthex(platform.plic.base);
+    uart_puts(", clint ");
+    uart_puthex(platform.clint.base);
+    uart_puts(", ");
+    uart_putu((unsigned long)platform.nvirtio);
+    uart_puts(" virtio-mmio\n");
+}
@@ -0,0 +1,37 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+/* What the machine looks like: RAM, harts and device addresses, read from
+   the flattened device tree (FDT) the firmware passes in a1 at entry. The
+   fields start out as the QEMU virt layout with -m 128M, which is what is
+   used if there is no valid blob. */
+
+#define PLATFORM_MAX_HARTS 8
+#define PLATFORM_MAX_VIRTIO 8
+
+typedef struct {
+    unsigned long base, size;
+} mmio_range;
+
+typedef struct {
+    int from_fdt;            /* 0: the defaults were kept */
+    unsigned long ram_base, ram_size;
+    unsigned long boot_hart; /* hart id we booted on (a0 at entry) */
+    int nharts;
+    unsigned long harts[PLATFORM_MAX_HARTS]; /* hart ids, boot hart included */
+    int parked;              /* secondary harts started and parked */
+    mmio_range uart, plic, clint;
+    int uart_irq;
+    int nvirtio;
+    mmio_range virtio[PLATFORM_MAX_VIRTIO];
+} platform_info;
+
+extern platform_info platform;
+
+/* record a0/a1 from entry; before any init stage */
+void platform_boot_args(unsigned long hartid, const void *dtb);
+/* parse the FDT, start the other harts and print what was found. Runs
+   before kalloc: the blob may sit in RAM the page pool hands out later. */
+void platform_init(void);
+
+#endif
@@ -0,0 +1,33 @@
+#include "plic.h"
+#include "platform.h"
+#include "riscv.h"
+#include <stdint.h>
+
+#define PLIC_BASE (platform.plic.base)
+#define PLIC_PRIORITY(irq) (PLIC_BASE + 4UL * (irq))
+/* QEMU virt numbers contexts M, S per hart: 2 * hart + 1 is the boot
+   hart's S-mode context */
+#define PLIC_CTX (2 * platform.boot_hart + 1)
+#define PLIC_SENABLE (PLIC_BASE + 0x2000UL + 0x80UL * PLIC_CTX)
+#define PLIC_STHRESHOLD (PLIC_BASE + 0x200000UL + 0x1000UL * PLIC_CTX)
+#define PLIC_SCLAIM (PLIC_STHRESHOLD + 4)
+
+#define REG(a) (*(volatile uint32_t *)(a))
+
+void plic_init(void) {
+    REG(PLIC_STHRESHOLD) = 0;
+    w_sie(r_sie() | SIE_SEIE);
+}
+
+void plic_enable(int irq) {
+    REG(PLIC_PRIORITY(irq)) = 1;
+    REG(PLIC_SENABLE + 4UL * (irq / 32)) |= 1U << (irq % 32);
+}
+
+int plic_claim(void) {
+    return (int)REG(PLIC_SCLAIM);
+}
+
+void plic_complete(int irq) {
+    REG(PLIC_SCLAIM) = (uint32_t)irq;
+}
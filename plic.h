@@ -0,0 +1,13 @@
+#ifndef PLIC_H
+#define PLIC_H
+
+/* Platform-level interrupt controller, S-mode context of the boot hart.
+   Base address and the UART's irq come from the FDT (platform.h). */
+
+void plic_init(void);
+void plic_enable(int irq);
+/* highest-priority pending irq (0 = none); must be completed */
+int plic_claim(void);
+void plic_complete(int irq);
+
+#endif
@@ -0,0 +1,152 @@
+#include "prof.h"
+#include "thread.h"
+#include "timer.h"
+#include "riscv.h"
+#include "shell.h"
+#include "uart.h"
+#include "string.h"
+
+/* One buffer: only the boot hart schedules threads (platform.c parks the
+   others). Kernel code addresses fit in 32 bits, and so do user ones
+   (USER_BASE), which keeps a sample at 24 bytes.
+
+   The callers come from ra, which is the caller's return address until
+   the interrupted function makes a call of its own (profsym.py drops it
+   when it points back into the same function), and, in a kernel built
+   with PROF_FP=1 (frame pointers), from walking the saved s0 chain. */
+
+#define PROF_NAMES 32
+#define PROF_FP_SPAN 0x4000 /* frames must lie this close above sp: the boot stack */
+#define PROF_DUMP_BATCH 64  /* lines between yields while dumping */
+
+typedef struct {
+    unsigned int pc[1 + PROF_DEPTH]; /* pc, then return addresses, 0 = none */
+    unsigned short tid;
+    unsigned char user;              /* sampled in U-mode */
+} prof_sample;
+
+static prof_sample samples[PROF_SAMPLES];
+static struct {
+    tid_t tid;
+    char name[16];
+} names[PROF_NAMES]; /* threads seen, so exited ones still have a name */
+static int nsamples, nnames;
+static unsigned long dropped;
+static int running, rate;
+
+int prof_start(int hz) {
+    if (hz <= 0 || hz > PROF_HZ_MAX) return -1;
+    nsamples = nnames = 0;
+    dropped = 0;
+    rate = hz;
+    running = 1;
+    timer_sample_period(TIMER_PROF, TIMEBASE_HZ / (unsigned long)hz);
+    timer_sample_arm();
+    return 0;
+}
+
+void prof_stop(void) {
+    running = 0;
+    timer_sample_period(TIMER_PROF, 0);
+}
+
+static void note_name(void) {
+    thread_run_stat st;
+    if (thread_run_self(&st) < 0) return;
+    for (int i = 0; i < nnames; ++i) {
+        if (names[i].tid == st.tid) return;
+    }
+    if (nnames == PROF_NAMES) return;
+    names[nnames].tid = st.tid;
+    strlcpy(names[nnames].name, st.name, sizeof(names[nnames].name));
+    nnames++;
+}
+
+void prof_tick(const trapframe *tf) {
+    if (!running) return;
+    if (nsamples == PROF_SAMPLES) {
+        dropped++;
+        return;
+    }
+    prof_sample *s = &samples[nsamples++];
+    memset(s, 0, sizeof(*s));
+    s->tid = (unsigned short)thread_self();
+    s->user = !(tf->sstatus & SSTATUS_SPP);
+    s->pc[0] = (unsigned int)tf->sepc;
+    note_name();
+    if (s->user) return; /* ra and s0 belong to the program */
+    int d = 1;
+    s->pc[d++] = (unsigned int)tf->ra;
+#ifdef PROF_FP
+    /* s0 is the frame's top: saved ra at -8, the caller's s0 at -16 */
+    unsigned long fp = tf->s0;
+    while (d <= PROF_DEPTH && fp > tf->sp && fp - tf->sp <= PROF_FP_SPAN && !(fp & 7)) {
+        s->pc[d++] = (unsigned int)((unsigned long *)fp)[-1];
+        unsigned long up = ((unsigned long *)fp)[-2];
+        if (up <= fp) break; /* frames grow upwards towards older callers */
+        fp = up;
+    }
+#endif
+}
+
+void prof_dump(void) {
+    prof_stop();
+    uart_puts("# prof begin hz ");
+    uart_putu((unsigned long)rate);
+    uart_puts(" samples ");
+    uart_putu((unsigned long)nsamples);
+    uart_puts(" dropped ");
+    uart_putu(dropped);
+    uart_puts("\n");
+    for (int i = 0; i < nnames; ++i) {
+        uart_puts("T ");
+        uart_putu((unsigned long)names[i].tid);
+        uart_puts(" ");
+        uart_puts(names[i].name);
+        uart_puts("\n");
+    }
+    for (int i = 0; i < nsamples; ++i) {
+        const prof_sample *s = &samples[i];
+        uart_puts("S ");
+        uart_putu(s->tid);
+        uart_puts(s->user ? " u" : " k");
+        for (int d = 0; d <= PROF_DEPTH && s->pc[d]; ++d) {
+            uart_puts(" ");
+            uart_puthex(s->pc[d]);
+        }
+        uart_puts("\n");
+        /* a long dump must not trip the watchdog */
+        if (i % PROF_DUMP_BATCH == PROF_DUMP_BATCH - 1) thread_yield();
+    }
+    uart_puts("# prof end\n");
+}
+
+static int prof_cmd(const char *args) {
+    char word[8], nbuf[12];
+    shell_word(&args, word, sizeof(word));
+    if (!strcmp(word, "start")) {
+        int hz = shell_word(&args, nbuf, sizeof(nbuf)) ? shell_int(nbuf) : PROF_HZ;
+        if (prof_start(hz) < 0) uart_puts("prof: rate must be 1..10000 Hz\n");
+    } else if (!strcmp(word, "stop")) {
+        prof_stop();
+    } else if (!strcmp(word, "dump")) {
+        prof_dump();
+    } else if (!word[0]) {
+        uart_puts(running ? "prof: running, " : "prof: stopped, ");
+        uart_putu((unsigned long)nsamples);
+        uart_puts(" samples, ");
+        uart_putu(dropped);
+        uart_puts(" dropped\n");
+    } else {
+        uart_puts("prof usage: prof [start [hz]|stop|dump]\n");
+    }
+    return 0;
+}
+
+void prof_init(void) {
+    shell_register("prof", prof_cmd, "prof [start [hz]|stop|dump]");
+}
+
+unsigned long prof_static_bytes(void) {
+    return sizeof(samples) + sizeof(names);
+}
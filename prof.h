@@ -0,0 +1,29 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include "trap.h"
+
+/* Sampling profiler. While it runs, the supervisor timer records the
+   interrupted pc, a few return addresses and the tid of whatever thread is
+   on the CPU; `prof dump` prints the samples for profsym.py to symbolize
+   against kernel.elf. Idle time is not sampled: the timer belongs to the
+   next sleeper then. */
+
+#define PROF_SAMPLES 2048
+#define PROF_DEPTH 4   /* return addresses kept per sample */
+#define PROF_HZ 500    /* default rate */
+#define PROF_HZ_MAX 10000
+
+/* register the prof command */
+void prof_init(void);
+/* clear the buffer and sample at hz; -1 if hz is out of range */
+int prof_start(int hz);
+void prof_stop(void);
+/* print the samples (stops sampling first) */
+void prof_dump(void);
+/* a timer sample of the running thread (trap.c) */
+void prof_tick(const trapframe *tf);
+/* sample buffer and thread names, all static */
+unsigned long prof_static_bytes(void);
+
+#endif
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Symbolize a `prof dump` against kernel.elf.
+
+Capture the console while dumping, e.g.
+
+    ./runqemu.sh | tee qemu.log      # then: prof start, <workload>, prof dump
+    ./profsym.py kernel.elf qemu.log
+    ./profsym.py kernel.elf qemu.log --folded > prof.folded
+    flamegraph.pl prof.folded > prof.svg
+
+The flat profile counts samples by the function the pc was in (self time).
+--folded prints one line per distinct stack, outermost frame first, rooted
+at the thread name, for flamegraph.pl or speedscope. Only the last dump in
+the log is used.
+"""
+
+import argparse
+import bisect
+import os
+import shutil
+import subprocess
+import sys
+from collections import Counter
+
+
+def find_nm():
+    for nm in (os.environ.get("NM"), "riscv64-unknown-elf-nm", "riscv64-linux-gnu-nm", "llvm-nm", "nm"):
+        if nm and shutil.which(nm):
+            return nm
+    sys.exit("profsym: no nm found (set NM)")
+
+
+def load_symbols(elf):
+    """Sorted (address, name) of the kernel's code symbols."""
+    out = subprocess.run([find_nm(), "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            syms.append((int(parts[0], 16), parts[2]))
+    return syms
+
+
+class Symbolizer:
+    def __init__(self, syms):
+        self.addrs = [a for a, _ in syms]
+        self.names = [n for _, n in syms]
+
+    def __call__(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        return self.names[i] if i >= 0 else "0x%x" % addr
+
+
+def parse_dump(lines):
+    """Thread names and samples (tid, user, [pc, callers...]) of the last dump."""
+    names, samples, header = {}, [], None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# prof begin"):
+            names, samples, header = {}, [], line
+        elif header is None:
+            continue
+        elif line.startswith("T "):
+            _, tid, name = line.split(None, 2)
+            names[int(tid)] = name
+        elif line.startswith("S "):
+            parts = line.split()
+            samples.append((int(parts[1]), parts[2] == "u", [int(a, 16) for a in parts[3:]]))
+        elif line.startswith("# prof end"):
+            break
+    if header is None:
+        sys.exit("profsym: no '# prof begin' in the log")
+    return header, names, samples
+
+
+def frames(sym, user, addrs):
+    """Innermost first, one entry per function: ra is dropped when the
+    interrupted function already made a call, and the frame walk repeats ra
+    for functions with frames of their own."""
+    if user:
+        return ["[user]"]
+    out = []
+    for i, a in enumerate(addrs):
+        # return addresses point after the call: look up the call itself
+        name = sym(a if i == 0 else a - 1)
+        if not out or out[-1] != name:
+            out.append(name)
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf", help="kernel.elf the samples came from")
+    ap.add_argument("log", nargs="?", help="console log with a prof dump (default: stdin)")
+    ap.add_argument("--folded", action="store_true", help="print folded stacks instead of the flat profile")
+    ap.add_argument("--top", type=int, default=30, help="flat profile rows (default 30)")
+    args = ap.parse_args()
+
+    with (open(args.log, errors="replace") if args.log else sys.stdin) as f:
+        header, names, samples = parse_dump(f)
+    sym = Symbolizer(load_symbols(args.elf))
+
+    if args.folded:
+        stacks = Counter()
+        for tid, user, addrs in samples:
+            thread = "%s:%d" % (names.get(tid, "?"), tid)
+            stacks[";".join([thread] + frames(sym, user, addrs)[::-1])] += 1
+        for stack, n in sorted(stacks.items()):
+            print(stack, n)
+        return
+
+    total = len(samples) or 1
+    flat = Counter(frames(sym, user, addrs)[0] for _, user, addrs in samples)
+    threads = Counter(names.get(tid, "?") for tid, _, _ in samples)
+    print(header.lstrip("# "))
+    print("%7s %6s  %s" % ("samples", "self%", "function"))
+    for name, n in flat.most_common(args.top):
+        print("%7d %5.1f%%  %s" % (n, 100.0 * n / total, name))
+    print("\nby thread:")
+    for name, n in threads.most_common():
+        print("%7d %5.1f%%  %s" % (n, 100.0 * n / total, name))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,18 +1,156 @@
+#include "config.h"
 #include "prog.h"
 #include "fs.h"
 #include "apps.h"
 #include "string.h"
 #include "uart.h"
 #include "thread.h"
+#include "riscv.h"
+#include "vm.h"
+#include "elf.h"
+#include "kalloc.h"
+#include "trap.h"
+#include "ring.h"
+#include "shell.h"
+#include "mbox.h"
+#include "pipe.h"
+#include <stddef.h>
+
+/* Scripts are compiled once by prog_load into a flat instruction array.
+   String operands (text, file and app names) are interned into a per-program
+   pool and referenced by offset, so the run loop never re-parses text.
+   prog_verify then resolves capabilities against the compiled form once, so
+   the run loop carries no permission checks.
+   Native programs are ELF executables instead: the image holds the file and
+   every instance gets its own copy of the segments, run in U-mode, with
+   capabilities checked per system call (syscall.c). */
+
+enum {
+    OP_PRINT = 0,   /* a = text */
+    OP_PRINTF,      /* a = text with $rN references */
+    OP_YIELD,
+    OP_SLEEP,       /* a = ticks */
+    OP_SPAWN,       /* a = app name */
+    OP_WRITE,       /* a = file name, b = data */
+    OP_WRITEF,      /* a = file name, b = data with $rN references */
+    OP_READ,        /* a = file name */
+    OP_EXIT,
+    OP_BAD,         /* unknown command, rejected by the verifier */
+    OP_SET,         /* r = a fn b */
+    OP_JMP,         /* goto t */
+    OP_JZ,          /* if !(a fn b) goto t */
+    OP_LOOP,        /* loop slot r = a; if <= 0 goto t */
+    OP_ENDLOOP,     /* if --slot r > 0 goto t */
+    OP_SEND,        /* a = mailbox name, b = text with $rN/$m references, t = mailbox slot */
+    OP_RECV,        /* a = mailbox name, t = mailbox slot; r = register for its number, PROG_REGS = none */
+    OP_INPUT,       /* line from the input pipe; r as for OP_RECV */
+    OP_COUNT
+};
+
+/* operators for set/if */
+enum {
+    FN_MOV = 0, FN_ADD, FN_SUB, FN_MUL, FN_DIV, FN_MOD,
+    FN_EQ, FN_NE, FN_LT, FN_GT, FN_LE, FN_GE
+};
+
+#define IMM_A 0x1 /* operand a is a literal, not a register */
+#define IMM_B 0x2
 
 typedef struct {
-    int used;
+    unsigned char op;  /* OP_* */
+    unsigned char fn;  /* FN_* */
+    unsigned char imm; /* IMM_* */
+    unsigned char r;   /* destination register or loop slot */
+    int a;             /* pool offset, register or literal */
+    int b;             /* second pool offset, register or literal */
+    int t;             /* jump target */
+} prog_insn;
+
+/* per-run limits; 0 means unlimited */
+typedef struct {
+    int spawns;      /* apps spawned */
+    int wbytes;      /* FS bytes written */
+    int ops_per_sec; /* interpreter op rate */
+    int cpu_ms;      /* CPU time */
+} prog_quota;
+
+/* counters accumulated over all runs */
+typedef struct {
+    unsigned long runs;
+    unsigned long ops;
+    unsigned long rbytes;
+    unsigned long wbytes;
+    unsigned long spawns;
+    unsigned long ticks;       /* rdtime ticks spent running */
+    unsigned long quota_exits; /* runs stopped by a quota */
+} prog_stats;
+
+/* Compiled, verified program. Immutable once published: instances share
+   it by reference and a reload swaps in a new image for new instances only,
+   the old one is freed when its last instance exits. */
+typedef struct {
+    int refs;     /* 0 = free slot; the name table and each instance hold one */
     char name[PROG_NAME];
     char script[PROG_SCRIPT];
     int caps;
+    int verified; /* passed prog_verify (or elf_check); only verified images run */
+    unsigned char *elf;     /* native program: the ELF file (one kalloc page), else NULL */
+    unsigned long elf_len;
+    prog_insn code[PROG_CODE];
+    int ncode;
+    char pool[PROG_POOL];
+    int npool;
+    int mbox[PROG_MBOXES]; /* pool offsets of the mailbox names send/recv use */
+    int nmbox;
+} prog_image;
+
+/* name table entry: current image plus tuning and accumulated counters */
+typedef struct {
+    int used;
+    unsigned int gen; /* bumped on drop so exiting instances don't credit a reused slot */
+    char name[PROG_NAME];
+    prog_image *image;
+    int budget;       /* ops between automatic yields */
+    prog_quota quota;
+    prog_stats stats;
 } user_prog;
 
+/* per-run quota bookkeeping */
+typedef struct {
+    unsigned long ops;       /* ops executed this run */
+    unsigned long spawns;
+    unsigned long rbytes;
+    unsigned long wbytes;
+    unsigned long cpu0;      /* thread_cputime at start */
+    unsigned long win_start; /* ops/s window */
+    unsigned long win_ops;
+} prog_run_state;
+
+/* per-instance execution context; the only allocation a run needs */
+typedef struct {
+    int used;
+    tid_t tid;
+    prog_image *image;
+    vm_space *vs;      /* the instance's own address space */
+    int slot;          /* progs[] entry to credit at exit */
+    unsigned int gen;
+    int pc;            /* instruction index, saved at yield points */
+    int regs[PROG_REGS];
+    int loops[PROG_NEST];
+    int budget;
+    prog_quota quota;  /* snapshot taken at start */
+    prog_run_state rs;
+    unsigned long entry, usp; /* native: where U-mode starts */
+    char msg[MBOX_MSG + 1]; /* last message recv'd or line input, $m in text */
+    int in, out;       /* pipe ends from a shell pipeline, -1 = none */
+    const char *over;  /* quota a charge found exceeded, NULL = none */
+    int mbox[PROG_MBOXES]; /* image's mailboxes, opened for the run (-1 = none) */
+    unsigned int mbox_gen[PROG_MBOXES];
+} prog_ctx;
+
+static prog_image images[PROG_IMAGES];
 static user_prog progs[PROG_MAX];
+static prog_ctx ctxs[PROG_INSTANCES];
 
 static int find_prog(const char *name) {
     for (int i = 0; i < PROG_MAX; ++i) {
@@ -21,28 +159,607 @@ static int find_prog(const char *name) {
     return -1;
 }
 
+static int prog_cmd(const char *args);
+static void prog_thread_gone(tid_t tid, int status);
+
 void prog_init(void) {
-    for (int i = 0; i < PROG_MAX; ++i) {
-        progs[i].used = 0;
-        progs[i].name[0] = '\0';
-        progs[i].script[0] = '\0';
-        progs[i].caps = 0;
+    /* the tables start zeroed (.bss): every slot is free */
+    thread_set_exit_hook(prog_thread_gone);
+    shell_register("prog", prog_cmd, "prog ls|runall|load|loadfile|loadelf|save|run|drop|budget|quota|stat");
+}
+
+static prog_image *image_alloc(void) {
+    for (int i = 0; i < PROG_IMAGES; ++i) {
+        if (images[i].refs == 0) {
+            images[i].refs = 1;
+            images[i].verified = 0;
+            images[i].elf = NULL;
+            images[i].elf_len = 0;
+            images[i].ncode = 0;
+            images[i].npool = 0;
+            images[i].nmbox = 0;
+            return &images[i];
+        }
     }
+    return NULL;
 }
 
-int prog_load(const char *name, const char *script, int caps) {
-    int idx = find_prog(name);
-    if (idx < 0) {
-        for (int i = 0; i < PROG_MAX; ++i) {
-            if (!progs[i].used) { idx = i; break; }
+static void image_get(prog_image *im) {
+    im->refs++;
+}
+
+static void image_put(prog_image *im) {
+    if (im && --im->refs == 0) {
+        im->verified = 0;
+        if (im->elf) kfree_page(im->elf, KMEM_ELF);
+        im->elf = NULL;
+    }
+}
+
+static prog_ctx *ctx_alloc(void) {
+    for (int i = 0; i < PROG_INSTANCES; ++i) {
+        if (!ctxs[i].used) {
+            memset(&ctxs[i], 0, sizeof(ctxs[i]));
+            ctxs[i].used = 1;
+            ctxs[i].in = ctxs[i].out = -1;
+            for (int k = 0; k < PROG_MBOXES; ++k) ctxs[i].mbox[k] = -1;
+            return &ctxs[i];
+        }
+    }
+    return NULL;
+}
+
+/* credit the run to its name (unless it was dropped meanwhile) and drop the
+   instance's image reference */
+static void ctx_release(prog_ctx *c, int quota_exit) {
+    user_prog *p = &progs[c->slot];
+    if (p->used && p->gen == c->gen) {
+        p->stats.runs++;
+        p->stats.ops += c->rs.ops;
+        p->stats.rbytes += c->rs.rbytes;
+        p->stats.wbytes += c->rs.wbytes;
+        p->stats.spawns += c->rs.spawns;
+        /* released on its own thread, but never wrap if it is gone */
+        if (thread_exists(c->tid)) p->stats.ticks += thread_cputime(c->tid) - c->rs.cpu0;
+        if (quota_exit) p->stats.quota_exits++;
+    }
+    /* script-made mailboxes go with their last user */
+    for (int k = 0; k < PROG_MBOXES; ++k) {
+        if (c->mbox[k] >= 0) mbox_close(c->mbox[k], c->mbox_gen[k]);
+        c->mbox[k] = -1;
+    }
+    image_put(c->image);
+    c->image = NULL;
+    ring_release(c->tid); /* its page goes with the space */
+    vm_space_destroy(c->vs);
+    c->vs = NULL;
+    /* neighbours in the pipeline see EOF or a broken pipe */
+    if (c->in >= 0) pipe_close_read(c->in);
+    if (c->out >= 0) pipe_close_write(c->out);
+    c->in = c->out = -1;
+    c->used = 0;
+}
+
+#if CONFIG_PROG_SCRIPTS
+/* helpers for the compiler */
+static const char *skip_ws(const char *p) {
+    while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') p++;
+    return p;
+}
+
+static const char *skip_blank(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static int take_word(const char **p, char *out, int max) {
+    const char *s = skip_blank(*p);
+    int n = 0;
+    while (*s && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r' && *s != ';' && n + 1 < max) {
+        out[n++] = *s++;
+    }
+    out[n] = '\0';
+    *p = s;
+    return n;
+}
+
+/* rest of the current command (up to ';' or newline), leading blanks skipped */
+static int take_rest(const char **p, char *out, int max) {
+    const char *s = skip_blank(*p);
+    int n = 0;
+    while (*s && *s != ';' && *s != '\n' && *s != '\r' && n + 1 < max) out[n++] = *s++;
+    out[n] = '\0';
+    *p = s;
+    return n;
+}
+
+/* wraps past INT_MAX, like the arithmetic below (no signed overflow) */
+static int parse_int(const char *s) {
+    unsigned int v = 0;
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (unsigned int)(*s - '0');
+        s++;
+    }
+    return (int)v;
+}
+
+/* compile-time state that only lives while prog_load runs */
+#define PROG_LABELS 16
+
+typedef struct {
+    char name[16];
+    int at;         /* instruction index, -1 while only referenced */
+} prog_label;
+
+typedef struct {
+    prog_label labels[PROG_LABELS];
+    int nlabels;
+    int fixups[PROG_CODE]; /* label index per OP_JMP awaiting resolution */
+    int blk_at[PROG_NEST]; /* instruction that opened each if/else/loop block */
+    int nblk;
+    int loops;             /* open loops, selects the counter slot */
+    const char *err;
+} prog_cc;
+
+static prog_cc cc;
+
+/* add a string to the pool (reusing an identical entry); returns offset or -1 */
+static int intern(prog_image *p, const char *s) {
+    int off = 0;
+    while (off < p->npool) {
+        if (strcmp(p->pool + off, s) == 0) return off;
+        off += (int)strlen(p->pool + off) + 1;
+    }
+    int len = (int)strlen(s) + 1;
+    if (p->npool + len > PROG_POOL) return -1;
+    memcpy(p->pool + p->npool, s, (unsigned long)len);
+    off = p->npool;
+    p->npool += len;
+    return off;
+}
+
+static prog_insn *emit(prog_image *p, int op, int a, int b) {
+    if (p->ncode >= PROG_CODE) { cc.err = "too many ops"; return NULL; }
+    prog_insn *in = &p->code[p->ncode];
+    in->op = (unsigned char)op;
+    in->fn = FN_MOV;
+    in->imm = 0;
+    in->r = 0;
+    in->a = a;
+    in->b = b;
+    in->t = 0;
+    cc.fixups[p->ncode] = -1;
+    p->ncode++;
+    return in;
+}
+
+static int find_label(const char *name) {
+    for (int i = 0; i < cc.nlabels; ++i) {
+        if (strcmp(cc.labels[i].name, name) == 0) return i;
+    }
+    if (cc.nlabels >= PROG_LABELS) return -1;
+    strlcpy(cc.labels[cc.nlabels].name, name, sizeof(cc.labels[0].name));
+    cc.labels[cc.nlabels].at = -1;
+    return cc.nlabels++;
+}
+
+static int define_label(prog_image *p, const char *name) {
+    int l = find_label(name);
+    if (l < 0) { cc.err = "too many labels"; return -1; }
+    if (cc.labels[l].at >= 0) { cc.err = "duplicate label"; return -1; }
+    cc.labels[l].at = p->ncode;
+    return 0;
+}
+
+/* "rN" -> N, or -1 */
+static int parse_reg(const char *w) {
+    if (w[0] != 'r' || w[1] < '0' || w[1] > '9') return -1;
+    int n = parse_int(w + 1);
+    return n < PROG_REGS ? n : -1;
+}
+
+/* register or (possibly negative) literal; sets *is_imm */
+static int parse_operand(const char *w, int *val, int *is_imm) {
+    int r = parse_reg(w);
+    if (r >= 0) { *val = r; *is_imm = 0; return 0; }
+    int neg = (*w == '-');
+    if (neg) w++;
+    if (*w < '0' || *w > '9') return -1;
+    *val = neg ? -parse_int(w) : parse_int(w);
+    *is_imm = 1;
+    return 0;
+}
+
+static int parse_fn(const char *w) {
+    static const char *const names[] = {
+        "", "+", "-", "*", "/", "%", "==", "!=", "<", ">", "<=", ">="
+    };
+    for (int i = FN_ADD; i <= FN_GE; ++i) {
+        if (strcmp(w, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/* "x [op y]" into in->a/fn/b */
+static int parse_expr(const char **pc, prog_insn *in) {
+    char w[16];
+    int v, imm;
+    take_word(pc, w, sizeof(w));
+    if (parse_operand(w, &v, &imm) < 0) { cc.err = "bad operand"; return -1; }
+    in->a = v;
+    if (imm) in->imm |= IMM_A;
+    if (!take_word(pc, w, sizeof(w))) return 0;
+    int fn = parse_fn(w);
+    if (fn < 0) { cc.err = "bad operator"; return -1; }
+    in->fn = (unsigned char)fn;
+    take_word(pc, w, sizeof(w));
+    if (parse_operand(w, &v, &imm) < 0) { cc.err = "bad operand"; return -1; }
+    in->b = v;
+    if (imm) in->imm |= IMM_B;
+    return 0;
+}
+
+static int has_fmt(const char *s) {
+    while (*s) {
+        if (*s++ == '$') return 1;
+    }
+    return 0;
+}
+
+/* one command; returns 0 or -1 with cc.err set */
+static int compile_cmd(prog_image *p, const char **pc, const char *word) {
+    char arg[128], data[128];
+    prog_insn *in;
+    int len = (int)strlen(word);
+
+    if (len > 1 && word[len - 1] == ':') {
+        char name[16];
+        strlcpy(name, word, (unsigned long)(len < 16 ? len : 16));
+        return define_label(p, name);
+    }
+    if (strcmp(word, "label") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        return define_label(p, arg);
+    }
+    if (strcmp(word, "print") == 0) {
+        take_rest(pc, arg, sizeof(arg));
+        int s = intern(p, arg);
+        if (s < 0) { cc.err = "pool full"; return -1; }
+        return emit(p, has_fmt(arg) ? OP_PRINTF : OP_PRINT, s, 0) ? 0 : -1;
+    }
+    if (strcmp(word, "write") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        take_rest(pc, data, sizeof(data));
+        int f = intern(p, arg), d = intern(p, data);
+        if (f < 0 || d < 0) { cc.err = "pool full"; return -1; }
+        return emit(p, has_fmt(data) ? OP_WRITEF : OP_WRITE, f, d) ? 0 : -1;
+    }
+    if (strcmp(word, "spawn") == 0 || strcmp(word, "read") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        int s = intern(p, arg);
+        if (s < 0) { cc.err = "pool full"; return -1; }
+        return emit(p, word[0] == 's' ? OP_SPAWN : OP_READ, s, 0) ? 0 : -1;
+    }
+    if (strcmp(word, "send") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        take_rest(pc, data, sizeof(data));
+        int m = intern(p, arg), d = intern(p, data);
+        if (m < 0 || d < 0) { cc.err = "pool full"; return -1; }
+        return emit(p, OP_SEND, m, d) ? 0 : -1;
+    }
+    if (strcmp(word, "recv") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        int m = intern(p, arg);
+        if (m < 0) { cc.err = "pool full"; return -1; }
+        if (!(in = emit(p, OP_RECV, m, 0))) return -1;
+        in->r = PROG_REGS;
+        if (take_word(pc, data, sizeof(data))) {
+            int r = parse_reg(data);
+            if (r < 0) { cc.err = "bad register"; return -1; }
+            in->r = (unsigned char)r;
+        }
+        return 0;
+    }
+    if (strcmp(word, "input") == 0) {
+        if (!(in = emit(p, OP_INPUT, 0, 0))) return -1;
+        in->r = PROG_REGS;
+        if (take_word(pc, data, sizeof(data))) {
+            int r = parse_reg(data);
+            if (r < 0) { cc.err = "bad register"; return -1; }
+            in->r = (unsigned char)r;
+        }
+        return 0;
+    }
+    if (strcmp(word, "yield") == 0) return emit(p, OP_YIELD, 0, 0) ? 0 : -1;
+    if (strcmp(word, "exit") == 0) return emit(p, OP_EXIT, 0, 0) ? 0 : -1;
+    if (strcmp(word, "sleep") == 0) {
+        int v, imm;
+        take_word(pc, arg, sizeof(arg));
+        if (parse_operand(arg, &v, &imm) < 0) { cc.err = "bad operand"; return -1; }
+        if (imm && v <= 0) v = 1;
+        if (!(in = emit(p, OP_SLEEP, v, 0))) return -1;
+        if (imm) in->imm = IMM_A;
+        return 0;
+    }
+    if (strcmp(word, "set") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        int r = parse_reg(arg);
+        if (r < 0) { cc.err = "bad register"; return -1; }
+        if (!(in = emit(p, OP_SET, 0, 0))) return -1;
+        in->r = (unsigned char)r;
+        return parse_expr(pc, in);
+    }
+    if (strcmp(word, "jmp") == 0) {
+        take_word(pc, arg, sizeof(arg));
+        int l = find_label(arg);
+        if (l < 0) { cc.err = "too many labels"; return -1; }
+        if (!emit(p, OP_JMP, 0, 0)) return -1;
+        cc.fixups[p->ncode - 1] = l;
+        return 0;
+    }
+    if (strcmp(word, "if") == 0 || strcmp(word, "loop") == 0) {
+        if (cc.nblk >= PROG_NEST) { cc.err = "nested too deep"; return -1; }
+        if (word[0] == 'i') {
+            if (!(in = emit(p, OP_JZ, 0, 0))) return -1;
+            if (parse_expr(pc, in) < 0) return -1;
+        } else {
+            int v, imm;
+            take_word(pc, arg, sizeof(arg));
+            if (parse_operand(arg, &v, &imm) < 0) { cc.err = "bad operand"; return -1; }
+            if (!(in = emit(p, OP_LOOP, v, 0))) return -1;
+            if (imm) in->imm = IMM_A;
+            in->r = (unsigned char)cc.loops++;
+        }
+        cc.blk_at[cc.nblk++] = p->ncode - 1;
+        return 0;
+    }
+    if (strcmp(word, "else") == 0) {
+        if (cc.nblk == 0 || p->code[cc.blk_at[cc.nblk - 1]].op != OP_JZ) {
+            cc.err = "else without if";
+            return -1;
+        }
+        if (!emit(p, OP_JMP, 0, 0)) return -1;
+        /* the if's false branch lands after this jump */
+        p->code[cc.blk_at[cc.nblk - 1]].t = p->ncode;
+        cc.blk_at[cc.nblk - 1] = p->ncode - 1;
+        return 0;
+    }
+    if (strcmp(word, "end") == 0) {
+        if (cc.nblk == 0) { cc.err = "end without block"; return -1; }
+        prog_insn *open = &p->code[cc.blk_at[--cc.nblk]];
+        if (open->op == OP_LOOP) {
+            if (!(in = emit(p, OP_ENDLOOP, 0, 0))) return -1;
+            in->r = open->r;
+            in->t = cc.blk_at[cc.nblk] + 1;
+            cc.loops--;
+        }
+        open->t = p->ncode;
+        return 0;
+    }
+    return emit(p, OP_BAD, 0, 0) ? 0 : -1;
+}
+
+/* translate p->script into p->code/p->pool; returns 0 or -1 with cc.err set */
+static int prog_compile(prog_image *p) {
+    const char *pc = p->script;
+    p->ncode = 0;
+    p->npool = 0;
+    cc.nlabels = 0;
+    cc.nblk = 0;
+    cc.loops = 0;
+    cc.err = NULL;
+    while (1) {
+        pc = skip_ws(pc);
+        while (*pc == ';') pc = skip_ws(pc + 1);
+        if (!*pc) break;
+
+        char word[32];
+        take_word(&pc, word, sizeof(word));
+        if (compile_cmd(p, &pc, word) < 0) return -1;
+
+        /* drop whatever is left of this command */
+        while (*pc && *pc != ';' && *pc != '\n') pc++;
+    }
+    if (cc.nblk) { cc.err = "missing end"; return -1; }
+    /* falling off the end exits, so the run loop needs no bounds check */
+    if (!emit(p, OP_EXIT, 0, 0)) return -1;
+    for (int i = 0; i < p->ncode; ++i) {
+        if (cc.fixups[i] < 0) continue;
+        if (cc.labels[cc.fixups[i]].at < 0) { cc.err = "undefined label"; return -1; }
+        p->code[i].t = cc.labels[cc.fixups[i]].at;
+    }
+    return 0;
+}
+
+#endif /* CONFIG_PROG_SCRIPTS */
+
+#if CONFIG_PROG_SCRIPTS
+/* capability an op needs, 0 if none */
+static int op_cap(int op) {
+    switch (op) {
+    case OP_PRINT: case OP_PRINTF: return CAP_UART;
+    case OP_SPAWN: return CAP_SPAWN;
+    case OP_WRITE: case OP_WRITEF: return CAP_FS_W;
+    case OP_READ: return CAP_FS_R;
+    case OP_SEND: case OP_RECV: return CAP_MBOX;
+    default: return 0;
+    }
+}
+
+/* Load-time verifier: rejects images the runtime could not execute safely and
+   strips ops the program has no capability for, remapping jump targets so the
+   remaining code is dense. Returns 0 and sets p->verified, or -1 with cc.err. */
+static int prog_verify(prog_image *p) {
+    int keep[PROG_CODE + 1];
+    int n = 0;
+    static const char *const cap_ops[5] = { "print", "read", "write", "spawn", "send/recv" };
+    int denied[5] = {0}; /* per CAP_* bit */
+
+    for (int i = 0; i < p->ncode; ++i) {
+        const prog_insn *in = &p->code[i];
+        keep[i] = n;
+        switch (in->op) {
+        case OP_BAD:
+            cc.err = "unknown command";
+            return -1;
+        case OP_SPAWN:
+            if (!app_exists(p->pool + in->a)) { cc.err = "no such app"; return -1; }
+            break;
+        case OP_WRITE:
+            if (strlen(p->pool + in->b) >= FS_DATA_LEN) { cc.err = "data too long"; return -1; }
+            /* fall through */
+        case OP_WRITEF:
+        case OP_READ:
+            if (strlen(p->pool + in->a) >= FS_NAME_LEN) { cc.err = "file name too long"; return -1; }
+            break;
+        case OP_INPUT:
+            if (in->r > PROG_REGS) { cc.err = "bad register"; return -1; }
+            break;
+        case OP_RECV:
+            if (in->r > PROG_REGS) { cc.err = "bad register"; return -1; }
+            /* fall through */
+        case OP_SEND:
+            if (strlen(p->pool + in->a) >= MBOX_NAME) { cc.err = "mailbox name too long"; return -1; }
+            break;
+        case OP_SET:
+            if (in->r >= PROG_REGS) { cc.err = "bad register"; return -1; }
+            /* fall through */
+        case OP_JZ:
+            if ((!(in->imm & IMM_B) && (in->b < 0 || in->b >= PROG_REGS))) {
+                cc.err = "bad register";
+                return -1;
+            }
+            /* fall through */
+        case OP_SLEEP:
+        case OP_LOOP:
+            if ((!(in->imm & IMM_A) && (in->a < 0 || in->a >= PROG_REGS))) {
+                cc.err = "bad register";
+                return -1;
+            }
+            break;
+        default:
+            break;
         }
+        if ((in->op == OP_LOOP || in->op == OP_ENDLOOP) && in->r >= PROG_NEST) {
+            cc.err = "bad loop slot";
+            return -1;
+        }
+        if ((in->op == OP_JMP || in->op == OP_JZ || in->op == OP_LOOP || in->op == OP_ENDLOOP) &&
+            (in->t < 0 || in->t >= p->ncode)) {
+            cc.err = "bad jump target";
+            return -1;
+        }
+        int need = op_cap(in->op);
+        if (need && !(p->caps & need)) {
+            for (int b = 0; b < 5; ++b) {
+                if (need == (1 << b)) denied[b]++;
+            }
+            continue;
+        }
+        n++;
+    }
+    keep[p->ncode] = n;
+
+    /* compact; a jump into a stripped op lands on the next surviving one */
+    int out = 0;
+    p->nmbox = 0;
+    for (int i = 0; i < p->ncode; ++i) {
+        prog_insn in = p->code[i];
+        if (keep[i + 1] == keep[i]) continue;
+        if (in.op == OP_JMP || in.op == OP_JZ || in.op == OP_LOOP || in.op == OP_ENDLOOP) {
+            in.t = keep[in.t];
+        }
+        if (in.op == OP_SEND || in.op == OP_RECV) {
+            /* names are interned, so one mailbox is one pool offset; each
+               instance opens them all when it starts */
+            int k = 0;
+            while (k < p->nmbox && p->mbox[k] != in.a) k++;
+            if (k == PROG_MBOXES) {
+                cc.err = "too many mailboxes";
+                return -1;
+            }
+            if (k == p->nmbox) p->mbox[p->nmbox++] = in.a;
+            in.t = k;
+        }
+        p->code[out++] = in;
+    }
+    p->ncode = out;
+
+    for (int b = 0; b < 5; ++b) {
+        if (!denied[b]) continue;
+        uart_puts("[verify] ");
+        uart_puts(p->name);
+        uart_puts(": stripped ");
+        uart_puti(denied[b]);
+        uart_puts(" ");
+        uart_puts(cap_ops[b]);
+        uart_puts(" (no cap)\n");
+    }
+    p->verified = 1;
+    return 0;
+}
+
+#endif /* CONFIG_PROG_SCRIPTS */
+
+/* slot for name (its current entry on a reload), or -1 if the table is full */
+static int prog_slot(const char *name) {
+    int idx = find_prog(name);
+    if (idx >= 0) return idx;
+    for (int i = 0; i < PROG_MAX; ++i) {
+        if (!progs[i].used) return i;
     }
+    return -1;
+}
+
+/* make a verified image the current one for progs[idx] */
+static void prog_publish(int idx, const char *name, prog_image *im) {
+    user_prog *p = &progs[idx];
+    if (p->used) {
+        /* new instances pick up the new image; running ones keep theirs,
+           and a reload keeps the tuning and counters of the name */
+        prog_image *old = p->image;
+        p->image = im;
+        image_put(old);
+    } else {
+        p->used = 1;
+        strlcpy(p->name, name, PROG_NAME);
+        p->image = im;
+        p->budget = PROG_BUDGET;
+        memset(&p->quota, 0, sizeof(p->quota));
+        memset(&p->stats, 0, sizeof(p->stats));
+    }
+}
+
+int prog_load(const char *name, const char *script, int caps) {
+#if !CONFIG_PROG_SCRIPTS
+    (void)name; (void)script; (void)caps;
+    uart_puts("[prog] scripts are not in this build\n");
+    return -1;
+#else
+    int idx = prog_slot(name);
     if (idx < 0) return -1;
-    progs[idx].used = 1;
-    strlcpy(progs[idx].name, name, PROG_NAME);
-    strlcpy(progs[idx].script, script, PROG_SCRIPT);
-    progs[idx].caps = caps;
+    prog_image *im = image_alloc();
+    if (!im) return -1;
+    strlcpy(im->script, script, PROG_SCRIPT);
+    if (prog_compile(im) < 0) {
+        uart_puts("[prog] compile error: ");
+        uart_puts(cc.err ? cc.err : "?");
+        uart_puts("\n");
+        image_put(im);
+        return -1;
+    }
+    strlcpy(im->name, name, PROG_NAME);
+    im->caps = caps;
+    if (prog_verify(im) < 0) {
+        uart_puts("[verify] rejected: ");
+        uart_puts(cc.err);
+        uart_puts("\n");
+        image_put(im);
+        return -1;
+    }
+    prog_publish(idx, name, im);
     return 0;
+#endif
 }
 
 int prog_load_file(const char *name, const char *file, int caps) {
@@ -51,20 +768,107 @@ int prog_load_file(const char *name, const char *file, int caps) {
     return prog_load(name, buf, caps);
 }
 
+int prog_load_elf(const char *name, const char *file, int caps) {
+    int idx = prog_slot(name);
+    int len = fs_size(file);
+    if (idx < 0 || len <= 0) return -1;
+    /* the image is kept in one page */
+    if ((unsigned long)len > PAGE_SIZE) {
+        uart_puts("[verify] rejected: ELF larger than a page\n");
+        return -1;
+    }
+    prog_image *im = image_alloc();
+    if (!im) return -1;
+    im->elf = (unsigned char *)kalloc_page(KMEM_ELF);
+    if (!im->elf || fs_read_buf(file, im->elf, len) != len) {
+        image_put(im);
+        return -1;
+    }
+    im->elf_len = (unsigned long)len;
+    const char *why;
+    if (elf_check(im->elf, im->elf_len, &why) < 0) {
+        uart_puts("[verify] rejected: ");
+        uart_puts(why);
+        uart_puts("\n");
+        image_put(im);
+        return -1;
+    }
+    strlcpy(im->name, name, PROG_NAME);
+    im->script[0] = '\0';
+    im->caps = caps;
+    im->verified = 1;
+    prog_publish(idx, name, im);
+    return 0;
+}
+
 int prog_drop(const char *name) {
     int idx = find_prog(name);
     if (idx < 0) return -1;
+    /* running instances keep their own reference to the image */
+    image_put(progs[idx].image);
+    progs[idx].image = NULL;
     progs[idx].used = 0;
+    progs[idx].gen++;
     progs[idx].name[0] = '\0';
-    progs[idx].script[0] = '\0';
-    progs[idx].caps = 0;
     return 0;
 }
 
 int prog_save(const char *name, const char *file) {
     int idx = find_prog(name);
     if (idx < 0) return -1;
-    return fs_write(file, progs[idx].script);
+    const prog_image *im = progs[idx].image;
+    if (im->elf) return fs_write_buf(file, im->elf, (int)im->elf_len);
+    return fs_write(file, im->script);
+}
+
+int prog_set_budget(const char *name, int ops) {
+    int idx = find_prog(name);
+    if (idx < 0 || ops <= 0) return -1;
+    progs[idx].budget = ops;
+    return 0;
+}
+
+int prog_set_quota(const char *name, int spawns, int wbytes, int ops_per_sec, int cpu_ms) {
+    int idx = find_prog(name);
+    if (idx < 0) return -1;
+    progs[idx].quota.spawns = spawns;
+    progs[idx].quota.wbytes = wbytes;
+    progs[idx].quota.ops_per_sec = ops_per_sec;
+    progs[idx].quota.cpu_ms = cpu_ms;
+    return 0;
+}
+
+int prog_stat(const char *name) {
+    int idx = find_prog(name);
+    if (idx < 0) return -1;
+    const user_prog *p = &progs[idx];
+    uart_puts(p->name);
+    uart_puts(": runs:");
+    uart_putu(p->stats.runs);
+    uart_puts(" ops:");
+    uart_putu(p->stats.ops);
+    uart_puts(" read:");
+    uart_putu(p->stats.rbytes);
+    uart_puts("b written:");
+    uart_putu(p->stats.wbytes);
+    uart_puts("b spawns:");
+    uart_putu(p->stats.spawns);
+    uart_puts(" cpu-ms:");
+    uart_putu(p->stats.ticks / (TIMEBASE_HZ / 1000));
+    uart_puts(" (");
+    uart_putu(p->stats.ticks);
+    uart_puts(" ticks) quota-exits:");
+    uart_putu(p->stats.quota_exits);
+    uart_puts("\n quota: spawns:");
+    uart_puti(p->quota.spawns);
+    uart_puts(" fs-bytes:");
+    uart_puti(p->quota.wbytes);
+    uart_puts(" ops/s:");
+    uart_puti(p->quota.ops_per_sec);
+    uart_puts(" cpu-ms:");
+    uart_puti(p->quota.cpu_ms);
+    uart_puts(" (0 = unlimited)\n");
+    return 0;
 }
 
 void prog_list(void) {
@@ -74,150 +878,642 @@ void prog_list(void) {
             uart_puts(" - ");
             uart_puts(progs[i].name);
             uart_puts(" caps:");
-            char buf[16]; int n = 0;
-            int v = progs[i].caps;
-            char digits[8]; int d = 0;
-            if (v == 0) digits[d++] = '0';
-            while (v) { digits[d++] = '0' + (v % 10); v /= 10; }
-            for (int k = d - 1; k >= 0; --k) buf[n++] = digits[k];
-            buf[n] = '\0';
-            uart_puts(buf);
+            uart_puti(progs[i].image->caps);
+            if (progs[i].image->elf) {
+                uart_puts(" elf:");
+                uart_puti((int)progs[i].image->elf_len);
+                uart_puts("b");
+            } else {
+                uart_puts(" ops:");
+                uart_puti(progs[i].image->ncode);
+            }
+            uart_puts(" instances:");
+            uart_puti(progs[i].image->refs - 1);
+            uart_puts(" budget:");
+            uart_puti(progs[i].budget);
             uart_puts("\n");
         }
     }
 }
 
-/* helpers for interpreter */
-static const char *skip_ws(const char *p) {
-    while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') p++;
-    return p;
+int prog_image_stats(prog_image_stat *out, int max) {
+    int n = 0;
+    for (int i = 0; i < PROG_IMAGES && n < max; ++i) {
+        const prog_image *im = &images[i];
+        if (im->refs == 0) continue;
+        strlcpy(out[n].name, im->name, sizeof(out[n].name));
+        out[n].refs = im->refs;
+        out[n].code = (unsigned long)im->ncode * sizeof(prog_insn) + (unsigned long)im->npool;
+        out[n].elf = im->elf_len;
+        n++;
+    }
+    return n;
 }
 
-static int take_word(const char **p, char *out, int max) {
-    const char *s = skip_ws(*p);
+unsigned long prog_static_bytes(void) {
+    return sizeof(images) + sizeof(progs) + sizeof(ctxs);
+}
+
+/* "[prog:<name>] <a><b>\n" */
+static void prog_say(const prog_image *im, const char *a, const char *b) {
+    uart_puts("[prog:");
+    uart_puts(im->name);
+    uart_puts("] ");
+    uart_puts(a);
+    uart_puts(b);
+    uart_puts("\n");
+}
+
+#if CONFIG_PROG_SCRIPTS
+/* expand $rN, $m (the last message received) and $$ in src */
+static void format_text(const char *src, const int *regs, const char *msg, char *out, int max) {
     int n = 0;
-    while (*s && *s != ' ' && *s != '\n' && *s != ';' && n + 1 < max) {
-        out[n++] = *s++;
+    while (*src && n + 1 < max) {
+        if (src[0] == '$' && src[1] == '$') {
+            out[n++] = '$';
+            src += 2;
+        } else if (src[0] == '$' && src[1] == 'm') {
+            src += 2;
+            while (*msg && n + 1 < max) out[n++] = *msg++;
+        } else if (src[0] == '$' && src[1] == 'r' && src[2] >= '0' && src[2] <= '9') {
+            int r = src[2] - '0';
+            src += 3;
+            int v = r < PROG_REGS ? regs[r] : 0;
+            unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+            char digits[12]; int d = 0;
+            if (u == 0) digits[d++] = '0';
+            while (u) { digits[d++] = '0' + (u % 10); u /= 10; }
+            if (v < 0) digits[d++] = '-';
+            while (d && n + 1 < max) out[n++] = digits[--d];
+        } else {
+            out[n++] = *src++;
+        }
     }
     out[n] = '\0';
-    *p = s;
-    return n;
 }
 
-static int parse_int(const char *s) {
-    int v = 0;
-    while (*s >= '0' && *s <= '9') {
-        v = v * 10 + (*s - '0');
-        s++;
+/* leading (optionally negative) number of a message or line */
+static int msg_int(const char *s) {
+    return *s == '-' ? (int)(0u - (unsigned int)parse_int(s + 1)) : parse_int(s);
+}
+
+/* script arithmetic wraps (two's complement): + - * are done unsigned,
+   and y == -1 is taken apart for / and %, where INT_MIN / -1 overflows */
+static inline int prog_eval(int fn, int x, int y) {
+    switch (fn) {
+    case FN_ADD: return (int)((unsigned int)x + (unsigned int)y);
+    case FN_SUB: return (int)((unsigned int)x - (unsigned int)y);
+    case FN_MUL: return (int)((unsigned int)x * (unsigned int)y);
+    case FN_DIV: return y == -1 ? (int)(0u - (unsigned int)x) : y ? x / y : 0;
+    case FN_MOD: return y == -1 ? 0 : y ? x % y : 0;
+    case FN_EQ:  return x == y;
+    case FN_NE:  return x != y;
+    case FN_LT:  return x < y;
+    case FN_GT:  return x > y;
+    case FN_LE:  return x <= y;
+    case FN_GE:  return x >= y;
+    default:     return x;
     }
-    return v;
 }
 
-static void prog_thread(void *arg) {
-    user_prog *p = (user_prog *)arg;
-    const char *pc = p->script;
-    uart_puts("[prog:");
-    uart_puts(p->name);
-    uart_puts("] start\n");
-    while (1) {
-        pc = skip_ws(pc);
-        if (!*pc) break;
+#endif /* CONFIG_PROG_SCRIPTS */
 
-        char word[32];
-        take_word(&pc, word, sizeof(word));
+/* quota checks run when fuel runs out; returns the exhausted quota's name
+   or NULL */
+const char prog_over_rate[] = "ops/s";
 
-        if (strcmp(word, "print") == 0) {
-            if (!(p->caps & CAP_UART)) { uart_puts("[deny] print\n"); continue; }
-            pc = skip_ws(pc);
-            char line[128]; int n = 0;
-            while (*pc && *pc != ';' && n + 1 < (int)sizeof(line)) {
-                line[n++] = *pc++;
-            }
-            line[n] = '\0';
-            uart_puts("[prog:");
-            uart_puts(p->name);
-            uart_puts("] ");
-            uart_puts(line);
-            uart_puts("\n");
-        } else if (strcmp(word, "yield") == 0) {
-            thread_yield();
-        } else if (strcmp(word, "sleep") == 0) {
-            pc = skip_ws(pc);
-            char numbuf[16];
-            take_word(&pc, numbuf, sizeof(numbuf));
-            int n = parse_int(numbuf);
-            if (n <= 0) n = 1;
-            thread_sleep(n);
-        } else if (strcmp(word, "spawn") == 0) {
-            if (!(p->caps & CAP_SPAWN)) { uart_puts("[deny] spawn\n"); continue; }
-            char name[32];
-            take_word(&pc, name, sizeof(name));
-            app_spawn(name);
-        } else if (strcmp(word, "write") == 0) {
-            if (!(p->caps & CAP_FS_W)) { uart_puts("[deny] write\n"); continue; }
-            char fname[32];
-            take_word(&pc, fname, sizeof(fname));
-            pc = skip_ws(pc);
-            char data[128]; int n = 0;
-            while (*pc && *pc != ';' && n + 1 < (int)sizeof(data)) data[n++] = *pc++;
-            data[n] = '\0';
-            if (fs_write(fname, data) == 0) {
-                uart_puts("[prog:");
-                uart_puts(p->name);
-                uart_puts("] wrote ");
-                uart_puts(fname);
-                uart_puts("\n");
-            } else {
-                uart_puts("[prog:");
-                uart_puts(p->name);
-                uart_puts("] write fail\n");
-            }
-        } else if (strcmp(word, "read") == 0) {
-            if (!(p->caps & CAP_FS_R)) { uart_puts("[deny] read\n"); continue; }
-            char fname[32];
-            take_word(&pc, fname, sizeof(fname));
-            char buf[128];
-            if (fs_read(fname, buf, sizeof(buf)) == 0) {
-                uart_puts("[prog:");
-                uart_puts(p->name);
-                uart_puts("] ");
-                uart_puts(buf);
-                uart_puts("\n");
-            } else {
-                uart_puts("[prog:");
-                uart_puts(p->name);
-                uart_puts("] read fail\n");
-            }
-        } else if (strcmp(word, "exit") == 0) {
-            break;
+static const char *prog_throttle(prog_ctx *c, int wait) {
+    const prog_quota *q = &c->quota;
+    prog_run_state *rs = &c->rs;
+    if (q->cpu_ms &&
+        thread_cputime(c->tid) - rs->cpu0 >= (unsigned long)q->cpu_ms * (TIMEBASE_HZ / 1000)) {
+        return "cpu";
+    }
+    if (q->ops_per_sec) {
+        unsigned long now = r_time();
+        if (now - rs->win_start >= TIMEBASE_HZ) {
+            rs->win_start = now;
+            rs->win_ops = rs->ops;
+        } else if (rs->ops - rs->win_ops >= (unsigned long)q->ops_per_sec) {
+            /* the caller may not be the instance's thread, and the instance
+               can be gone by the time a sleep ends */
+            if (!wait) return prog_over_rate;
+            /* over the rate: sit out the rest of this window */
+            thread_sleep_until(rs->win_start + TIMEBASE_HZ);
+            rs->win_start = r_time();
+            rs->win_ops = rs->ops;
+        }
+    }
+    return NULL;
+}
+
+#if CONFIG_PROG_SCRIPTS
+static int prog_thread(void *arg) {
+    prog_ctx *c = (prog_ctx *)arg;
+    const prog_image *im = c->image;
+    const prog_insn *code = im->code;
+    const prog_insn *ip = code;
+    const char *pool = im->pool;
+    int *regs = c->regs;
+    int *loops = c->loops;
+    int fuel = c->budget;
+    const char *over = NULL;
+    char buf[128];
+    /* computed-goto dispatch: one indirect jump per instruction. The image
+       is verified, so there are no capability or operand checks here. */
+    static void *const dispatch[OP_COUNT] = {
+        [OP_PRINT] = &&op_print, [OP_PRINTF] = &&op_printf,
+        [OP_YIELD] = &&op_yield, [OP_SLEEP] = &&op_sleep,
+        [OP_SPAWN] = &&op_spawn, [OP_WRITE] = &&op_write,
+        [OP_WRITEF] = &&op_writef, [OP_READ] = &&op_read,
+        [OP_EXIT] = &&op_exit,
+        [OP_SET] = &&op_set, [OP_JMP] = &&op_jmp,
+        [OP_JZ] = &&op_jz, [OP_LOOP] = &&op_loop,
+        [OP_ENDLOOP] = &&op_endloop,
+        [OP_SEND] = &&op_send, [OP_RECV] = &&op_recv,
+        [OP_INPUT] = &&op_input,
+    };
+    /* every op burns one unit of fuel; an empty tank settles the op count,
+       checks the quotas and forces a yield so a looping script cannot
+       monopolize the CPU */
+#define REFUEL() do { \
+        c->rs.ops += (unsigned long)(c->budget - fuel); \
+        c->pc = (int)(ip - code); \
+        fuel = c->budget; \
+        if ((over = prog_throttle(c, 1)) != NULL) goto op_exit; \
+    } while (0)
+#define DISPATCH() do { \
+        if (--fuel <= 0) { REFUEL(); thread_yield(); } \
+        goto *dispatch[ip->op]; \
+    } while (0)
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+#define JUMP(to) do { ip = code + (to); DISPATCH(); } while (0)
+#define OPA() ((ip->imm & IMM_A) ? ip->a : regs[ip->a])
+#define OPB() ((ip->imm & IMM_B) ? ip->b : regs[ip->b])
+
+    c->rs.cpu0 = thread_cputime(c->tid);
+    c->rs.win_start = r_time();
+    prog_say(im, "start", "");
+    goto *dispatch[ip->op];
+
+op_print:
+    if (c->out >= 0) {
+        strlcpy(buf, pool + ip->a, sizeof(buf));
+        goto do_pipe;
+    }
+    prog_say(im, pool + ip->a, "");
+    NEXT();
+op_printf:
+    format_text(pool + ip->a, regs, c->msg, buf, sizeof(buf));
+    if (c->out >= 0) goto do_pipe;
+    prog_say(im, buf, "");
+    NEXT();
+do_pipe:
+    /* in a pipeline, print feeds the next stage a line at a time */
+    REFUEL();
+    {
+        int len = (int)strlen(buf);
+        buf[len] = '\n'; /* len < sizeof(buf): the NUL's place */
+        if (pipe_write(c->out, buf, len + 1) < 0) {
+            prog_say(im, "broken pipe", "");
+            goto op_exit;
+        }
+    }
+    NEXT();
+op_yield:
+    REFUEL();
+    thread_yield();
+    NEXT();
+op_sleep:
+    REFUEL();
+    thread_sleep(OPA() > 0 ? OPA() : 1);
+    NEXT();
+op_spawn:
+    if (c->quota.spawns && c->rs.spawns >= (unsigned long)c->quota.spawns) {
+        over = "spawns";
+        goto op_exit;
+    }
+    if (app_spawn(pool + ip->a) >= 0) c->rs.spawns++;
+    NEXT();
+op_write:
+    strlcpy(buf, pool + ip->b, sizeof(buf));
+    goto do_write;
+op_writef:
+    format_text(pool + ip->b, regs, c->msg, buf, sizeof(buf));
+do_write:
+    {
+        unsigned long len = strlen(buf);
+        if (c->quota.wbytes && c->rs.wbytes + len > (unsigned long)c->quota.wbytes) {
+            over = "fs bytes";
+            goto op_exit;
+        }
+        if (fs_write(pool + ip->a, buf) == 0) {
+            c->rs.wbytes += len;
+            prog_say(im, "wrote ", pool + ip->a);
         } else {
-            uart_puts("[prog:");
-            uart_puts(p->name);
-            uart_puts("] unknown cmd\n");
+            prog_say(im, "write fail", "");
         }
+    }
+    NEXT();
+op_read:
+    if (fs_read(pool + ip->a, buf, sizeof(buf)) == 0) {
+        c->rs.rbytes += strlen(buf);
+        prog_say(im, buf, "");
+    } else {
+        prog_say(im, "read fail", "");
+    }
+    NEXT();
+op_set:
+    regs[ip->r] = prog_eval(ip->fn, OPA(), OPB());
+    NEXT();
+op_jmp:
+    JUMP(ip->t);
+op_jz:
+    if (!prog_eval(ip->fn, OPA(), OPB())) JUMP(ip->t);
+    NEXT();
+op_loop:
+    loops[ip->r] = OPA();
+    if (loops[ip->r] <= 0) JUMP(ip->t);
+    NEXT();
+op_endloop:
+    if (--loops[ip->r] > 0) JUMP(ip->t);
+    NEXT();
+op_send:
+    /* the instance opened its mailboxes at start (prog_start): created by
+       whichever end comes first, gone with the last one */
+    format_text(pool + ip->b, regs, c->msg, buf, sizeof(buf));
+    REFUEL();
+    if (mbox_send(mbox_live(c->mbox[ip->t], c->mbox_gen[ip->t]), buf, (int)strlen(buf)) < 0) {
+        prog_say(im, "send fail", "");
+    }
+    NEXT();
+op_recv:
+    REFUEL();
+    {
+        int len = mbox_recv(mbox_live(c->mbox[ip->t], c->mbox_gen[ip->t]), c->msg, MBOX_MSG);
+        c->msg[len > 0 ? len : 0] = '\0';
+        if (len < 0) prog_say(im, "recv fail", "");
+        if (ip->r < PROG_REGS) regs[ip->r] = msg_int(c->msg);
+    }
+    NEXT();
+op_input:
+    /* end of input (or no input pipe) ends the instance */
+    REFUEL();
+    if (c->in < 0 || pipe_read_line(c->in, c->msg, sizeof(c->msg)) < 0) goto op_exit;
+    if (ip->r < PROG_REGS) regs[ip->r] = msg_int(c->msg);
+    NEXT();
+op_exit:
+#undef OPB
+#undef OPA
+#undef JUMP
+#undef NEXT
+#undef DISPATCH
+#undef REFUEL
+    c->rs.ops += (unsigned long)(c->budget - fuel);
+    if (over) prog_say(im, "quota exceeded: ", over);
+    prog_say(im, "exit", "");
+    ctx_release(c, over != NULL);
+    return over ? -1 : 0;
+}
+
+#endif /* CONFIG_PROG_SCRIPTS */
 
-        while (*pc == ';') pc++;
+/* native instances: the thread drops to U-mode and only comes back into
+   the kernel through traps (trap.c), which find their instance by tid */
+static int native_thread(void *arg) {
+    prog_ctx *c = (prog_ctx *)arg;
+    c->rs.cpu0 = thread_cputime(c->tid);
+    c->rs.win_start = r_time();
+    prog_say(c->image, "start", "");
+    user_enter(c->entry, c->usp);
+    /* not reached: the program leaves through native_stop */
+}
+
+static prog_ctx *ctx_by_tid(tid_t tid) {
+    for (int i = 0; i < PROG_INSTANCES; ++i) {
+        if (ctxs[i].used && ctxs[i].tid == tid) return &ctxs[i];
     }
+    return NULL;
+}
+
+static prog_ctx *ctx_self(void) {
+    return ctx_by_tid(thread_self());
+}
+
+int prog_self_caps(void) {
+    prog_ctx *c = ctx_self();
+    return c ? c->image->caps : 0;
+}
+
+vm_space *prog_self_vm(void) {
+    prog_ctx *c = ctx_self();
+    return c ? c->vs : NULL;
+}
+
+static void native_stop(prog_ctx *c, int code, const char *why, int quota_exit) __attribute__((noreturn));
+static void native_stop(prog_ctx *c, int code, const char *why, int quota_exit) {
+    if (quota_exit) prog_say(c->image, "quota exceeded: ", why);
+    else if (why) prog_say(c->image, "stopped: ", why);
     uart_puts("[prog:");
-    uart_puts(p->name);
-    uart_puts("] exit\n");
+    uart_puts(c->image->name);
+    uart_puts("] exit ");
+    uart_puti(code);
+    uart_puts("\n");
+    /* leaves the kernel address space active before the pages go */
+    ctx_release(c, quota_exit);
+    thread_exit(code);
+    while (1) asm volatile("wfi");
+}
+
+/* an instance whose thread exits without releasing its context (a kill,
+   e.g. by the ring poller over a quota) releases it here, on that thread */
+static void prog_thread_gone(tid_t tid, int status) {
+    prog_ctx *c = ctx_by_tid(tid);
+    if (!c) return;
+    if (c->over) prog_say(c->image, "quota exceeded: ", c->over);
+    else if (status == THREAD_KILLED) prog_say(c->image, "killed", "");
+    ctx_release(c, c->over != NULL);
+}
+
+static const char *ctx_charge(prog_ctx *c, int what, unsigned long n) {
+    switch (what) {
+    case PROG_CHARGE_OP:
+    case PROG_CHARGE_OP_NOWAIT: {
+        /* one op per syscall drives the ops/s quota; cpu is checked here too */
+        c->rs.ops += n;
+        const char *over = prog_throttle(c, what == PROG_CHARGE_OP);
+        if (over == prog_over_rate) c->rs.ops -= n;
+        return over;
+    }
+    case PROG_CHARGE_SPAWN:
+        if (c->quota.spawns && c->rs.spawns + n > (unsigned long)c->quota.spawns) return "spawns";
+        c->rs.spawns += n;
+        break;
+    case PROG_CHARGE_RBYTES:
+        c->rs.rbytes += n;
+        break;
+    case PROG_CHARGE_WBYTES:
+        if (c->quota.wbytes && c->rs.wbytes + n > (unsigned long)c->quota.wbytes) return "fs bytes";
+        c->rs.wbytes += n;
+        break;
+    }
+    return NULL;
+}
+
+const char *prog_charge(tid_t tid, int what, unsigned long n) {
+    prog_ctx *c = ctx_by_tid(tid);
+    if (!c) return NULL;
+    const char *over = ctx_charge(c, what, n);
+    if (over && over != prog_over_rate) c->over = over;
+    return over;
+}
+
+void prog_self_quota(const char *what) {
+    prog_ctx *c = ctx_self();
+    if (c) native_stop(c, -1, what, 1);
+    prog_self_exit(-1, what);
+}
+
+void prog_self_exit(int code, const char *why) {
+    prog_ctx *c = ctx_self();
+    if (!c) {
+        uart_puts("[prog] exit from a thread with no instance\n");
+        thread_exit(code);
+        while (1) asm volatile("wfi");
+    }
+    native_stop(c, code, why, 0);
+}
+
+/* harts for an instance: the one asked for, else batch work stays off hart
+   0 (the shell's) whenever another hart is online; 0 if cpu is offline */
+static unsigned long prog_cpus(int cpu) {
+    unsigned long online = thread_online_cpus();
+    if (cpu >= 0) return cpu < (int)(8 * sizeof(unsigned long)) ? online & (1UL << cpu) : 0;
+    return (online & ~1UL) ? online & ~1UL : online;
+}
+
+static void pipes_close(int in, int out) {
+    if (in >= 0) pipe_close_read(in);
+    if (out >= 0) pipe_close_write(out);
+}
+
+/* start one instance of progs[idx] on the harts in cpus, reading and
+   printing through the pipe ends in and out (-1: none), which it takes over
+   even when it fails; returns tid or -1 */
+static int prog_start(int idx, unsigned long cpus, int in, int out) {
+    user_prog *p = &progs[idx];
+    prog_ctx *c = NULL;
+    if (p->image && p->image->verified && cpus) c = ctx_alloc();
+    if (!c) {
+        pipes_close(in, out);
+        return -1;
+    }
+    c->in = in;
+    c->out = out;
+    c->image = p->image;
+    image_get(c->image);
+    c->slot = idx;
+    c->gen = p->gen;
+    c->budget = p->budget;
+    c->quota = p->quota;
+    c->vs = vm_space_create();
+#if CONFIG_PROG_SCRIPTS
+    thread_fn fn = prog_thread;
+#else
+    /* only native images load without scripts */
+    thread_fn fn = native_thread;
+#endif
+    if (c->vs && c->image->elf) {
+        /* fill the space now, while it is not active: no TLB entries exist
+           for it yet, so no flush is needed */
+        fn = native_thread;
+        c->entry = elf_load(c->vs, c->image->elf, c->image->elf_len, &c->usp);
+        if (!c->entry) {
+            uart_puts("[prog] out of memory loading ");
+            uart_puts(p->name);
+            uart_puts("\n");
+            vm_space_destroy(c->vs);
+            c->vs = NULL;
+        }
+    }
+    /* programs are batch work: below the shell and I/O threads */
+    tid_t tid = c->vs ? thread_spawn_prio(fn, c, p->name, THREAD_PRIO_DEFAULT - 1) : -1;
+    if (tid < 0) {
+        image_put(c->image);
+        vm_space_destroy(c->vs);
+        pipes_close(c->in, c->out);
+        c->used = 0;
+        return -1;
+    }
+    c->tid = tid;
+    thread_set_satp(tid, c->vs->satp);
+    /* a box that cannot be made fails its sends and receives, as before */
+    for (int k = 0; k < c->image->nmbox; ++k) {
+        c->mbox[k] = mbox_open(c->image->pool + c->image->mbox[k], &c->mbox_gen[k]);
+    }
+    /* it has not run yet, so it starts on an allowed hart */
+    thread_set_affinity(tid, cpus);
+    return (int)tid;
 }
 
 int prog_run(const char *name) {
+    return prog_run_cpu(name, -1);
+}
+
+int prog_run_cpu(const char *name, int cpu) {
+    return prog_run_piped(name, cpu, -1, -1);
+}
+
+int prog_run_piped(const char *name, int cpu, int in, int out) {
+    int idx = find_prog(name);
+    if (idx < 0) {
+        pipes_close(in, out);
+        return -1;
+    }
+    return prog_start(idx, prog_cpus(cpu), in, out);
+}
+
+int prog_run_n(const char *name, int n, int cpu) {
     int idx = find_prog(name);
     if (idx < 0) return -1;
-    tid_t tid = thread_spawn(prog_thread, &progs[idx], name);
-    return (int)tid;
+    int started = 0;
+    while (started < n && prog_start(idx, prog_cpus(cpu), -1, -1) >= 0) started++;
+    return started;
 }
 
 int prog_run_all(void) {
     int started = 0;
     for (int i = 0; i < PROG_MAX; ++i) {
-        if (progs[i].used) {
-            thread_spawn(prog_thread, &progs[i], progs[i].name);
-            started++;
-        }
+        if (progs[i].used && prog_start(i, prog_cpus(-1), -1, -1) >= 0) started++;
     }
     if (started == 0) return -1;
     return started;
 }
+
+static int prog_cmd(const char *args) {
+    args = shell_skip(args);
+    if (!strcmp(args, "ls")) { prog_list(); return 0; }
+    if (!strcmp(args, "runall")) {
+        int started = prog_run_all();
+        if (started < 0) uart_puts("no progs\n");
+        return 0;
+    }
+    if (!strncmp(args, "run ", 4)) {
+        char name[32], opt[8], nbuf[16];
+        int want = 0, cpu = -1;
+        args += 4;
+        shell_word(&args, name, sizeof(name));
+        while (shell_word(&args, opt, sizeof(opt))) {
+            shell_word(&args, nbuf, sizeof(nbuf));
+            if (!strcmp(opt, "-n")) want = shell_int(nbuf);
+            else if (!strcmp(opt, "--cpu")) cpu = shell_int(nbuf);
+        }
+        if (cpu >= 0 && !prog_cpus(cpu)) {
+            uart_puts("prog run: hart not online\n");
+            return 0;
+        }
+        int in, out;
+        shell_take_pipes(&in, &out);
+        if (want > 0 && (in >= 0 || out >= 0)) {
+            uart_puts("prog run: -n cannot be piped\n");
+            pipes_close(in, out);
+            return 0;
+        }
+        if (want > 0) {
+            int started = prog_run_n(name, want, cpu);
+            if (started < 0) {
+                uart_puts("no such prog\n");
+            } else if (started < want) {
+                uart_puts("prog run: out of threads/instances after ");
+                uart_puti(started);
+                uart_puts("\n");
+            }
+            return 0;
+        }
+        /* a single instance is a shell job, and can be a pipeline stage */
+        int tid = prog_run_piped(name, cpu, in, out);
+        if (tid < 0) uart_puts("no such prog\n");
+        return tid > 0 ? tid : 0;
+    }
+    if (!strncmp(args, "drop ", 5)) {
+        char name[32];
+        args += 5;
+        shell_word(&args, name, sizeof(name));
+        if (prog_drop(name) == 0) uart_puts("prog dropped\n");
+        else uart_puts("prog drop failed\n");
+        return 0;
+    }
+    if (!strncmp(args, "load ", 5)) {
+        char name[32], capsbuf[16];
+        args += 5;
+        shell_word(&args, name, sizeof(name));
+        shell_word(&args, capsbuf, sizeof(capsbuf));
+        int caps = shell_int(capsbuf);
+        args = shell_skip(args);
+        if (prog_load(name, args, caps) == 0) uart_puts("prog loaded\n");
+        else uart_puts("prog load failed\n");
+        return 0;
+    }
+    if (!strncmp(args, "loadfile ", 9)) {
+        char name[32], capsbuf[16], fname[32];
+        args += 9;
+        shell_word(&args, name, sizeof(name));
+        shell_word(&args, capsbuf, sizeof(capsbuf));
+        shell_word(&args, fname, sizeof(fname));
+        int caps = shell_int(capsbuf);
+        if (prog_load_file(name, fname, caps) == 0) uart_puts("prog loaded from file\n");
+        else uart_puts("prog loadfile failed\n");
+        return 0;
+    }
+    if (!strncmp(args, "loadelf ", 8)) {
+        char name[32], capsbuf[16], fname[32];
+        args += 8;
+        shell_word(&args, name, sizeof(name));
+        shell_word(&args, capsbuf, sizeof(capsbuf));
+        shell_word(&args, fname, sizeof(fname));
+        int caps = shell_int(capsbuf);
+        if (prog_load_elf(name, fname, caps) == 0) uart_puts("prog loaded (native)\n");
+        else uart_puts("prog loadelf failed\n");
+        return 0;
+    }
+    if (!strncmp(args, "budget ", 7)) {
+        char name[32], opsbuf[16];
+        args += 7;
+        shell_word(&args, name, sizeof(name));
+        shell_word(&args, opsbuf, sizeof(opsbuf));
+        if (prog_set_budget(name, shell_int(opsbuf)) == 0) uart_puts("prog budget set\n");
+        else uart_puts("prog budget failed\n");
+        return 0;
+    }
+    if (!strncmp(args, "quota ", 6)) {
+        char name[32], q[4][16];
+        args += 6;
+        shell_word(&args, name, sizeof(name));
+        for (int i = 0; i < 4; ++i) shell_word(&args, q[i], sizeof(q[i]));
+        if (prog_set_quota(name, shell_int(q[0]), shell_int(q[1]), shell_int(q[2]), shell_int(q[3])) == 0) {
+            uart_puts("prog quota set\n");
+        } else {
+            uart_puts("prog quota failed\n");
+        }
+        return 0;
+    }
+    if (!strncmp(args, "stat ", 5)) {
+        char name[32];
+        args += 5;
+        shell_word(&args, name, sizeof(name));
+        if (prog_stat(name) < 0) uart_puts("no such prog\n");
+        return 0;
+    }
+    if (!strncmp(args, "save ", 5)) {
+        char name[32], fname[32];
+        args += 5;
+        shell_word(&args, name, sizeof(name));
+        shell_word(&args, fname, sizeof(fname));
+        if (prog_save(name, fname) == 0) uart_puts("prog saved\n");
+        else uart_puts("prog save failed\n");
+        return 0;
+    }
+    uart_puts("prog usage: prog ls|runall|load <name> <caps> <script>|loadfile <name> <caps> <file>|loadelf <name> <caps> <file>|run <name> [-n N] [--cpu N]|drop <name>|save <name> <file>|budget <name> <ops>\n");
+    uart_puts("           quota <name> <spawns> <fs-bytes> <ops/s> <cpu-ms>|stat <name>\n");
+    return 0;
+}
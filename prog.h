@@ -1,23 +1,81 @@
 #ifndef PROG_H
 #define PROG_H
 
-#define PROG_MAX 8
+#include "config.h"
+#include "vm.h"
+#include "thread.h"
+
+#define PROG_MAX CONFIG_PROG_MAX
+#define PROG_IMAGES (PROG_MAX * 2) /* room for old images still running after a reload */
+#define PROG_INSTANCES 32          /* running instances (each also needs a thread) */
 #define PROG_NAME 16
-#define PROG_SCRIPT 256
+#define PROG_SCRIPT CONFIG_PROG_SCRIPT
+#define PROG_CODE 64     /* compiled instructions per program */
+#define PROG_POOL 256    /* interned operand strings per program */
+#define PROG_REGS 8      /* integer registers r0..r7 */
+#define PROG_NEST 4      /* nested if/loop blocks */
+#define PROG_MBOXES 4    /* distinct mailboxes a script uses */
+#define PROG_BUDGET 32   /* default ops executed before an automatic yield */
 
 /* capability bits */
 #define CAP_UART   0x1
 #define CAP_FS_R   0x2
 #define CAP_FS_W   0x4
 #define CAP_SPAWN  0x8
+#define CAP_MBOX   0x10 /* send/recv on mailboxes */
 
 void prog_init(void);
 int prog_load(const char *name, const char *script, int caps);
 int prog_load_file(const char *name, const char *file, int caps);
+/* native program: a RISC-V ELF executable from the FS, run in U-mode */
+int prog_load_elf(const char *name, const char *file, int caps);
 int prog_run(const char *name);
+/* same, pinned to hart cpu (-1: default placement, off hart 0 when other
+   harts are online) */
+int prog_run_cpu(const char *name, int cpu);
+/* same, as a pipeline stage: scripts read with input from in and print to
+   out (pipe.h ends, -1 = none); the instance owns both ends from here on,
+   even if it fails to start */
+int prog_run_piped(const char *name, int cpu, int in, int out);
+/* start up to n instances sharing the current image; returns how many started */
+int prog_run_n(const char *name, int n, int cpu);
 int prog_run_all(void);
 int prog_drop(const char *name);
 int prog_save(const char *name, const char *file);
+int prog_set_budget(const char *name, int ops);
+/* per-run limits (0 = unlimited): app spawns, FS bytes written, ops/s, CPU ms */
+int prog_set_quota(const char *name, int spawns, int wbytes, int ops_per_sec, int cpu_ms);
+/* print accumulated counters and quotas for a program */
+int prog_stat(const char *name);
 void prog_list(void);
 
+/* memory held by a loaded image (current or kept alive by old instances) */
+typedef struct {
+    char name[PROG_NAME];
+    int refs;           /* name table + running instances */
+    unsigned long code; /* compiled instructions and string pool in use */
+    unsigned long elf;  /* native program file, in a KMEM_ELF page */
+} prog_image_stat;
+/* fill out with up to max images in use; returns the count */
+int prog_image_stats(prog_image_stat *out, int max);
+/* image, name and instance tables, all static */
+unsigned long prog_static_bytes(void);
+
+/* the running native instance, for the syscall layer */
+enum { PROG_CHARGE_OP, PROG_CHARGE_OP_NOWAIT, PROG_CHARGE_SPAWN, PROG_CHARGE_RBYTES, PROG_CHARGE_WBYTES };
+int prog_self_caps(void);
+vm_space *prog_self_vm(void);
+/* account n units against the quotas of the instance running on tid;
+   returns the exhausted quota's name (and charges nothing) or NULL. Over
+   the ops/s rate, PROG_CHARGE_OP sleeps the caller to the end of the
+   window; PROG_CHARGE_OP_NOWAIT, for charges made from another thread
+   (the ring poller), never sleeps and returns prog_over_rate instead, to
+   be retried later. */
+const char *prog_charge(tid_t tid, int what, unsigned long n);
+extern const char prog_over_rate[];
+/* end the instance (why: NULL for a normal exit) */
+void prog_self_exit(int code, const char *why) __attribute__((noreturn));
+/* end the instance for exceeding a quota */
+void prog_self_quota(const char *what) __attribute__((noreturn));
+
 #endif
@@ -0,0 +1,119 @@
+#include "ring.h"
+#include "ioring.h"
+#include "elf.h"
+#include "uart.h"
+#include "prog.h"
+#include <stddef.h>
+
+/* io rings: one shared page per native instance. Submissions are ordinary
+   system calls (syscall_run with ring_only set), so they get the same
+   capability checks and user-pointer copies as a trap, just many per entry
+   into the kernel. */
+
+#define RING_MAX 8
+
+typedef struct {
+    int used;
+    sys_caller who;      /* owner; in_trap is 0 for everything run from here */
+    struct io_ring *q;   /* kernel address of the shared page */
+    tid_t poller;        /* IORING_SQPOLL thread, or 0 */
+} kring;
+
+static kring rings[RING_MAX];
+
+_Static_assert(sizeof(struct io_ring) <= PAGE_SIZE, "io_ring must fit in one page");
+_Static_assert((IORING_ENTRIES & (IORING_ENTRIES - 1)) == 0, "IORING_ENTRIES must be a power of two");
+
+static kring *find_ring(tid_t tid) {
+    for (int i = 0; i < RING_MAX; ++i) {
+        if (rings[i].used && rings[i].who.tid == tid) return &rings[i];
+    }
+    return NULL;
+}
+
+/* run queued SQEs until the SQ is empty or the CQ is full. The program
+   owns sq_tail and cq_head, so those are read with acquire; each SQE is
+   copied out before use since the program may rewrite it at any time.
+   Each SQE counts as one op, like a trapping system call: over a quota,
+   a program draining its own ring (in_trap) is stopped there, and the
+   SQPOLL poller fails the entry with IORING_EQUOTA and kills the owner.
+   Only the owner sleeps out the ops/s rate; anyone else must not yield
+   here (the owner could exit and free the ring), so it leaves the rest of
+   the SQ for a later pass. */
+static int ring_drain(kring *r, int in_trap) {
+    struct io_ring *q = r->q;
+    unsigned int head = q->sq_head;
+    unsigned int ctail = q->cq_tail;
+    int done = 0;
+    while (head != __atomic_load_n(&q->sq_tail, __ATOMIC_ACQUIRE)) {
+        if (ctail - __atomic_load_n(&q->cq_head, __ATOMIC_ACQUIRE) >= IORING_ENTRIES) break;
+        struct io_sqe sqe = q->sq[head & (IORING_ENTRIES - 1)];
+        struct io_cqe *cqe = &q->cq[ctail & (IORING_ENTRIES - 1)];
+        int own = r->who.tid == thread_self();
+        const char *over = prog_charge(r->who.tid, own ? PROG_CHARGE_OP : PROG_CHARGE_OP_NOWAIT, 1);
+        if (over == prog_over_rate) break;
+        if (over && in_trap) prog_self_quota(over);
+        cqe->res = over ? IORING_EQUOTA : syscall_run(&r->who, sqe.nr, sqe.args, 1);
+        cqe->user_data = sqe.user_data;
+        head++;
+        ctail++;
+        __atomic_store_n(&q->sq_head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(&q->cq_tail, ctail, __ATOMIC_RELEASE);
+        done++;
+        if (over) {
+            thread_kill(r->who.tid);
+            break;
+        }
+    }
+    return done;
+}
+
+/* IORING_SQPOLL: drain whenever scheduled, nap when idle */
+static int ring_poller(void *arg) {
+    kring *r = (kring *)arg;
+    tid_t owner = r->who.tid;
+    while (r->used && r->who.tid == owner) {
+        if (ring_drain(r, 0) == 0) thread_sleep(1);
+        else thread_yield();
+    }
+    return 0;
+}
+
+long ring_setup(const sys_caller *who, unsigned long flags) {
+    if (find_ring(who->tid)) return -1;
+    kring *r = NULL;
+    for (int i = 0; i < RING_MAX; ++i) {
+        if (!rings[i].used) { r = &rings[i]; break; }
+    }
+    if (!r) return -1;
+    /* owned by the space: freed with it when the instance exits */
+    r->q = (struct io_ring *)vm_alloc_page(who->vs, USER_RING_VA, PTE_U | PTE_R | PTE_W);
+    if (!r->q) return -1;
+    vm_flush(who->vs); /* the caller is running in that space */
+    r->who = *who;
+    r->who.in_trap = 0;
+    r->poller = 0;
+    r->used = 1;
+    if (flags & IORING_SQPOLL) {
+        r->poller = thread_spawn(ring_poller, r, "ring-poll");
+        if (r->poller < 0) {
+            uart_puts("[ring] no thread for the poller, use ring_enter\n");
+            r->poller = 0;
+        }
+    }
+    return (long)USER_RING_VA;
+}
+
+long ring_enter(const sys_caller *who) {
+    kring *r = find_ring(who->tid);
+    if (!r) return -1;
+    return ring_drain(r, who->in_trap);
+}
+
+void ring_release(tid_t tid) {
+    kring *r = find_ring(tid);
+    if (!r) return;
+    /* the poller notices on its next pass and returns */
+    r->used = 0;
+    r->q = NULL;
+}
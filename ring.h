@@ -0,0 +1,15 @@
+#ifndef RING_H
+#define RING_H
+
+#include "trap.h"
+
+/* Kernel side of the io ring (ABI in ioring.h). */
+
+/* map who's ring page (once per instance); returns its user address or -1 */
+long ring_setup(const sys_caller *who, unsigned long flags);
+/* drain who's submission queue now; returns completions posted or -1 */
+long ring_enter(const sys_caller *who);
+/* forget tid's ring (instance exit, before its space is destroyed) */
+void ring_release(tid_t tid);
+
+#endif
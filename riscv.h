@@ -0,0 +1,121 @@
+#ifndef RISCV_H
+#define RISCV_H
+
+/* Small RISC-V helpers shared across the kernel. */
+
+/* QEMU virt mtime frequency (ticks per second seen through rdtime) */
+#define TIMEBASE_HZ 10000000UL
+
+static inline unsigned long r_time(void) {
+    unsigned long t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+/* supervisor address translation and protection */
+#define SATP_SV39 (8UL << 60)
+#define SATP_ASID_SHIFT 44
+#define SATP_ASID_MASK 0xffffUL
+
+static inline unsigned long r_satp(void) {
+    unsigned long x;
+    asm volatile("csrr %0, satp" : "=r"(x));
+    return x;
+}
+
+static inline void w_satp(unsigned long x) {
+    asm volatile("csrw satp, %0" : : "r"(x));
+}
+
+static inline void sfence_vma(void) {
+    asm volatile("sfence.vma zero, zero" : : : "memory");
+}
+
+static inline void sfence_vma_asid(unsigned long asid) {
+    asm volatile("sfence.vma zero, %0" : : "r"(asid) : "memory");
+}
+
+/* supervisor status and trap CSRs */
+#define SSTATUS_SIE  (1UL << 1)
+#define SSTATUS_SPIE (1UL << 5)
+#define SSTATUS_SPP  (1UL << 8)
+/* FP (FS) and vector (VS) unit state: Off traps on use, Dirty means the
+   registers were written since the field was last set */
+#define SSTATUS_VS   (3UL << 9)
+#define SSTATUS_FS   (3UL << 13)
+#define SSTATUS_FS_OFF   (0UL << 13)
+#define SSTATUS_FS_CLEAN (2UL << 13)
+#define SSTATUS_FS_DIRTY (3UL << 13)
+
+/* sie / sip bits */
+#define SIE_SSIE (1UL << 1) /* software (IPI) */
+#define SIE_STIE (1UL << 5) /* timer */
+#define SIE_SEIE (1UL << 9) /* external (PLIC) */
+
+/* scause: interrupt flag and the interrupt codes we use */
+#define SCAUSE_INTR (1UL << 63)
+#define IRQ_S_SOFT  1
+#define IRQ_S_TIMER 5
+#define IRQ_S_EXT   9
+
+static inline unsigned long r_sstatus(void) {
+    unsigned long x;
+    asm volatile("csrr %0, sstatus" : "=r"(x));
+    return x;
+}
+
+static inline void w_sstatus(unsigned long x) {
+    asm volatile("csrw sstatus, %0" : : "r"(x));
+}
+
+static inline void s_sstatus(unsigned long bits) {
+    asm volatile("csrs sstatus, %0" : : "r"(bits));
+}
+
+static inline void c_sstatus(unsigned long bits) {
+    asm volatile("csrc sstatus, %0" : : "r"(bits));
+}
+
+/* sstatus.SIE off; returns its previous state for intr_restore */
+static inline unsigned long intr_off(void) {
+    unsigned long x;
+    asm volatile("csrrc %0, sstatus, %1" : "=r"(x) : "r"(SSTATUS_SIE) : "memory");
+    return x & SSTATUS_SIE;
+}
+
+static inline void intr_restore(unsigned long sie) {
+    asm volatile("csrs sstatus, %0" : : "r"(sie & SSTATUS_SIE) : "memory");
+}
+
+static inline void w_stvec(unsigned long x) {
+    asm volatile("csrw stvec, %0" : : "r"(x));
+}
+
+static inline void w_sscratch(unsigned long x) {
+    asm volatile("csrw sscratch, %0" : : "r"(x));
+}
+
+static inline unsigned long r_sie(void) {
+    unsigned long x;
+    asm volatile("csrr %0, sie" : "=r"(x));
+    return x;
+}
+
+static inline void w_sie(unsigned long x) {
+    asm volatile("csrw sie, %0" : : "r"(x));
+}
+
+/* pending interrupts, same bit layout as sie */
+static inline unsigned long r_sip(void) {
+    unsigned long x;
+    asm volatile("csrr %0, sip" : "=r"(x));
+    return x;
+}
+
+/* sleep until an interrupt enabled in sie is pending (sstatus.SIE may
+   stay off: the hart wakes up without taking the trap) */
+static inline void wfi(void) {
+    asm volatile("wfi" : : : "memory");
+}
+
+#endif
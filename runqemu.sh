@@ -70,7 +70,9 @@ main() {
     ensure_kernel
 
     echo "Using QEMU: $QEMU_BIN"
-    exec "$QEMU_BIN" -machine virt -nographic -m 128M -kernel "$SCRIPT_DIR/kernel.bin"
+    # the kernel reads RAM size and harts from the device tree, so these
+    # need no rebuild
+    exec "$QEMU_BIN" -machine virt -nographic -m "${QEMU_MEM:-128M}" -smp "${QEMU_SMP:-1}" -kernel "$SCRIPT_DIR/kernel.bin"
 }
 
 main "$@"
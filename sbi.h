@@ -0,0 +1,35 @@
+#ifndef SBI_H
+#define SBI_H
+
+/* Calls into the SBI firmware (OpenSBI) below us. */
+
+#define SBI_EXT_BASE 0x10
+#define SBI_EXT_TIME 0x54494D45
+#define SBI_LEGACY_SET_TIMER 0x00
+
+struct sbiret {
+    long error;
+    long value;
+};
+
+static inline struct sbiret sbi_call(long ext, long fid, long a0, long a1, long a2) {
+    register long r_a0 asm("a0") = a0;
+    register long r_a1 asm("a1") = a1;
+    register long r_a2 asm("a2") = a2;
+    register long r_a6 asm("a6") = fid;
+    register long r_a7 asm("a7") = ext;
+    asm volatile("ecall"
+                 : "+r"(r_a0), "+r"(r_a1)
+                 : "r"(r_a2), "r"(r_a6), "r"(r_a7)
+                 : "memory");
+    struct sbiret ret = { r_a0, r_a1 };
+    return ret;
+}
+
+/* nonzero if the firmware implements extension ext */
+static inline long sbi_probe(long ext) {
+    struct sbiret r = sbi_call(SBI_EXT_BASE, 3, ext, 0, 0);
+    return r.error ? 0 : r.value;
+}
+
+#endif
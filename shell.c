@@ -0,0 +1,391 @@
+#include "shell.h"
+#include "console.h"
+#include "thread.h"
+#include "string.h"
+#include "uart.h"
+#include "pipe.h"
+#include "riscv.h"
+#include <stddef.h>
+
+/* Commands live in an open-addressed hash table keyed by name (FNV-1a,
+   linear probing) so dispatch costs one hash and usually one compare, not a
+   strcmp per command. cmds[] keeps registration order for help. */
+
+#define SHELL_HASH 64 /* power of two, at least twice SHELL_MAX_CMDS */
+#define SHELL_JOBS 8
+#define SHELL_STAGES 4 /* commands per pipeline */
+#define SHELL_LINE 320 /* room for a prog load of a full-size script */
+
+typedef struct {
+    const char *name;
+    shell_fn fn;
+    const char *usage;
+} shell_cmd;
+
+static shell_cmd cmds[SHELL_MAX_CMDS];
+static int ncmds;
+static unsigned char slots[SHELL_HASH]; /* index into cmds + 1, 0 = empty */
+
+static tid_t jobs[SHELL_JOBS]; /* background jobs, 0 = free */
+static int stage_in = -1, stage_out = -1; /* current stage's unclaimed pipe ends */
+
+/* hex with a 0x prefix, else decimal */
+static unsigned long parse_mask(const char *s) {
+    if (s[0] != '0' || (s[1] != 'x' && s[1] != 'X')) return (unsigned long)shell_int(s);
+    unsigned long v = 0;
+    for (s += 2; *s; ++s) {
+        int d = (*s >= '0' && *s <= '9') ? *s - '0' :
+                (*s >= 'a' && *s <= 'f') ? *s - 'a' + 10 :
+                (*s >= 'A' && *s <= 'F') ? *s - 'A' + 10 : -1;
+        if (d < 0) break;
+        v = (v << 4) | (unsigned long)d;
+    }
+    return v;
+}
+
+const char *shell_skip(const char *s) {
+    while (*s == ' ') s++;
+    return s;
+}
+
+int shell_word(const char **p, char *out, int max) {
+    const char *s = shell_skip(*p);
+    int n = 0;
+    while (*s && *s != ' ' && n + 1 < max) {
+        out[n++] = *s++;
+    }
+    out[n] = '\0';
+    *p = s;
+    return n;
+}
+
+int shell_int(const char *s) {
+    int v = 0;
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (*s - '0');
+        s++;
+    }
+    return v;
+}
+
+static unsigned int hash(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const shell_cmd *lookup(const char *name) {
+    for (unsigned int i = hash(name), n = 0; n < SHELL_HASH; ++i, ++n) {
+        int k = slots[i % SHELL_HASH];
+        if (k == 0) return NULL;
+        if (!strcmp(cmds[k - 1].name, name)) return &cmds[k - 1];
+    }
+    return NULL;
+}
+
+int shell_register(const char *name, shell_fn fn, const char *usage) {
+    if (ncmds >= SHELL_MAX_CMDS || lookup(name)) return -1;
+    unsigned int i = hash(name);
+    while (slots[i % SHELL_HASH]) i++;
+    cmds[ncmds].name = name;
+    cmds[ncmds].fn = fn;
+    cmds[ncmds].usage = usage;
+    slots[i % SHELL_HASH] = (unsigned char)(++ncmds);
+    return 0;
+}
+
+static int job_add(tid_t tid) {
+    for (int i = 0; i < SHELL_JOBS; ++i) {
+        if (jobs[i] == 0) {
+            jobs[i] = tid;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void job_remove(tid_t tid) {
+    for (int i = 0; i < SHELL_JOBS; ++i) {
+        if (jobs[i] == tid) jobs[i] = 0;
+    }
+}
+
+/* report background jobs that finished since the last prompt */
+static void jobs_reap(void) {
+    for (int i = 0; i < SHELL_JOBS; ++i) {
+        if (jobs[i] && !thread_exists(jobs[i])) {
+            uart_puts("[");
+            uart_puti(jobs[i]);
+            uart_puts("] done\n");
+            jobs[i] = 0;
+        }
+    }
+}
+
+/* join tid; ^C interrupts the join (console_set_waiter) and then kills
+   the job, or with detach leaves it running as a background job. Returns
+   1 if interrupted. */
+static int wait_job(tid_t tid, int detach) {
+    int intr = 0;
+    console_set_waiter(thread_self());
+    while (thread_join(tid, NULL) < 0 && thread_exists(tid)) {
+        if ((intr = console_take_intr()) != 0) break;
+        /* a stale interrupt, or someone else joins it: poll for the end */
+        thread_sleep(1);
+    }
+    console_set_waiter(0);
+    if (!intr) return 0;
+    uart_puts("^C\n");
+    if (!detach) thread_kill(tid);
+    else if (job_add(tid) < 0) uart_puts("job table full\n");
+    return 1;
+}
+
+/* job to act on: the tid argument, else the newest background job */
+static tid_t job_arg(const char *args) {
+    args = shell_skip(args);
+    if (*args) return shell_int(args);
+    for (int i = SHELL_JOBS - 1; i >= 0; --i) {
+        if (jobs[i]) return jobs[i];
+    }
+    return 0;
+}
+
+static int cmd_help(const char *args) {
+    (void)args;
+    uart_puts("commands (join with | to pipe one job into the next, end a line with & to run its job in the background, ^C stops waiting):\n");
+    for (int i = 0; i < ncmds; ++i) {
+        uart_puts("  ");
+        uart_puts(cmds[i].usage);
+        uart_puts("\n");
+    }
+    return 0;
+}
+
+static int cmd_stop(const char *args) {
+    (void)args;
+    uart_puts("stopping kernel — halting now.\n");
+    intr_off(); /* no watchdog samples either */
+    while (1) { asm volatile("wfi"); }
+    return 0;
+}
+
+static int cmd_ps(const char *args) {
+    (void)args;
+    thread_list();
+    return 0;
+}
+
+static int cmd_kill(const char *args) {
+    tid_t tid = shell_int(shell_skip(args));
+    if (tid == thread_self() || thread_kill(tid) < 0) uart_puts("no such tid\n");
+    else job_remove(tid);
+    return 0;
+}
+
+static int cmd_nice(const char *args) {
+    char tbuf[12], pbuf[8];
+    shell_word(&args, tbuf, sizeof(tbuf));
+    if (!shell_word(&args, pbuf, sizeof(pbuf)) || thread_set_prio(shell_int(tbuf), shell_int(pbuf)) < 0) {
+        uart_puts("nice usage: nice <tid> <0-15> (8+ is real-time)\n");
+    }
+    return 0;
+}
+
+static int cmd_taskset(const char *args) {
+    char tbuf[12], mbuf[24];
+    if (!shell_word(&args, tbuf, sizeof(tbuf))) {
+        uart_puts("taskset usage: taskset <tid> [mask]\n");
+        return 0;
+    }
+    tid_t tid = shell_int(tbuf);
+    if (shell_word(&args, mbuf, sizeof(mbuf))) {
+        if (thread_set_affinity(tid, parse_mask(mbuf)) < 0) uart_puts("taskset: no such tid or no online hart in mask\n");
+        return 0;
+    }
+    unsigned long mask = thread_get_affinity(tid);
+    if (!mask) {
+        uart_puts("no such tid\n");
+        return 0;
+    }
+    uart_puts("tid ");
+    uart_puti(tid);
+    uart_puts(" affinity ");
+    uart_puthex(mask);
+    uart_puts(" online ");
+    uart_puthex(thread_online_cpus());
+    uart_puts("\n");
+    return 0;
+}
+
+static int cmd_jobs(const char *args) {
+    (void)args;
+    for (int i = 0; i < SHELL_JOBS; ++i) {
+        if (jobs[i]) {
+            uart_puts("[");
+            uart_puti(jobs[i]);
+            uart_puts("] running\n");
+        }
+    }
+    return 0;
+}
+
+static int cmd_fg(const char *args) {
+    tid_t tid = job_arg(args);
+    if (tid <= 0 || !thread_exists(tid)) {
+        uart_puts("no such job\n");
+        return 0;
+    }
+    job_remove(tid);
+    console_take_intr(); /* a ^C typed earlier is not for this job */
+    wait_job(tid, 0);
+    return 0;
+}
+
+static int cmd_wait(const char *args) {
+    tid_t tid = job_arg(args);
+    if (tid <= 0 || !thread_exists(tid)) {
+        uart_puts("no such job\n");
+        return 0;
+    }
+    job_remove(tid);
+    console_take_intr();
+    wait_job(tid, 1);
+    return 0;
+}
+
+void shell_take_pipes(int *in, int *out) {
+    *in = stage_in;
+    *out = stage_out;
+    stage_in = stage_out = -1;
+}
+
+/* run one pipeline stage with the given pipe ends; returns its job tid or 0 */
+static tid_t run_stage(const char *args, int in, int out) {
+    char name[16];
+    tid_t tid = 0;
+    stage_in = in;
+    stage_out = out;
+    if (shell_word(&args, name, sizeof(name)) == 0) {
+        uart_puts("empty pipeline stage\n");
+    } else {
+        const shell_cmd *cmd = lookup(name);
+        if (cmd) tid = cmd->fn(shell_skip(args));
+        else uart_puts("unknown\n");
+    }
+    /* ends the command did not claim: close them so its neighbours see EOF
+       or a broken pipe rather than waiting forever */
+    if (stage_in >= 0) pipe_close_read(stage_in);
+    if (stage_out >= 0) pipe_close_write(stage_out);
+    stage_in = stage_out = -1;
+    return tid > 0 ? tid : 0;
+}
+
+static void run_line(char *line) {
+    /* a trailing '&' backgrounds the job the command starts */
+    int n = (int)strlen(line);
+    while (n > 0 && line[n - 1] == ' ') line[--n] = '\0';
+    int bg = n > 0 && line[n - 1] == '&';
+    if (bg) {
+        line[--n] = '\0';
+        while (n > 0 && line[n - 1] == ' ') line[--n] = '\0';
+    }
+    if (*shell_skip(line) == '\0') return;
+    /* "a | b | c": each '|' becomes a pipe from one stage's output to the
+       next one's input; all stages start before any is waited for */
+    char *stage[SHELL_STAGES];
+    int nstages = 1;
+    stage[0] = line;
+    for (char *p = line; *p; ++p) {
+        if (*p != '|') continue;
+        if (nstages == SHELL_STAGES) {
+            uart_puts("pipeline too long\n");
+            return;
+        }
+        *p = '\0';
+        stage[nstages++] = p + 1;
+    }
+    tid_t tids[SHELL_STAGES];
+    int in = -1;
+    for (int i = 0; i < nstages; ++i) {
+        int next = -1, out = -1;
+        if (i + 1 < nstages) {
+            int id = pipe_create();
+            if (id < 0) uart_puts("out of pipes\n");
+            next = out = id;
+        }
+        tids[i] = run_stage(stage[i], in, out);
+        in = next;
+    }
+    console_take_intr(); /* a ^C typed earlier is not for this job */
+    for (int i = 0; i < nstages; ++i) {
+        tid_t tid = tids[i];
+        if (tid == 0) continue;
+        if (!bg) {
+            if (wait_job(tid, 0)) {
+                /* ^C stops the whole pipeline */
+                for (int j = i + 1; j < nstages; ++j) {
+                    if (tids[j]) thread_kill(tids[j]);
+                }
+                return;
+            }
+        } else if (job_add(tid) == 0) {
+            uart_puts("[");
+            uart_puti(tid);
+            uart_puts("]\n");
+        } else {
+            uart_puts("job table full\n");
+        }
+    }
+}
+
+/* tiny shell: an ordinary thread, blocked in console_getc between keys */
+static int shell_thread(void *arg) {
+    (void)arg;
+    uart_puts("tiny-shell: type 'help' or 'stop'\n");
+    char buf[SHELL_LINE];
+    int pos = 0;
+    uart_puts("$ ");
+    for (;;) {
+        int c = console_getc();
+        if (c == '\r') c = '\n';
+        if (c == '\n') {
+            uart_puts("\n");
+            buf[pos] = '\0';
+            run_line(buf);
+            jobs_reap();
+            pos = 0;
+            uart_puts("$ ");
+        } else if (c == 8 || c == 127) { // backspace
+            if (pos > 0) {
+                pos--;
+                uart_puts("\b \b");
+            }
+        } else {
+            if (pos < (int)sizeof(buf)-1) {
+                buf[pos++] = (char)c;
+                uart_putc((char)c);
+            }
+        }
+    }
+    return 0;
+}
+
+void shell_start(void) {
+    shell_register("help", cmd_help, "help");
+    shell_register("stop", cmd_stop, "stop");
+    shell_register("ps", cmd_ps, "ps");
+    shell_register("kill", cmd_kill, "kill <tid>");
+    shell_register("nice", cmd_nice, "nice <tid> <prio>");
+    shell_register("taskset", cmd_taskset, "taskset <tid> [mask]");
+    shell_register("jobs", cmd_jobs, "jobs");
+    shell_register("fg", cmd_fg, "fg [tid]");
+    shell_register("wait", cmd_wait, "wait [tid]");
+    /* interactive: ahead of default-priority work, still in the normal
+       class, and on hart 0 with the UART interrupt */
+    tid_t tid = thread_spawn_prio(shell_thread, NULL, "shell", THREAD_PRIO_DEFAULT + 2);
+    thread_set_affinity(tid, 1UL);
+}
@@ -0,0 +1,32 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+/* Shell: a thread reading lines from the console and dispatching the first
+   word through a hashed command table. Subsystems register their own
+   commands from their init functions. */
+
+/* handler for "name args..."; returns the tid of a thread it started as a
+   job (the shell waits for it unless the line ends in '&'), else 0 */
+typedef int (*shell_fn)(const char *args);
+
+#define SHELL_MAX_CMDS 32
+
+/* usage is the one-line text shown by help; returns -1 if the table is full
+   or the name is taken */
+int shell_register(const char *name, shell_fn fn, const char *usage);
+
+/* spawn the shell thread */
+void shell_start(void);
+
+/* parsing helpers for command handlers */
+const char *shell_skip(const char *s);
+/* copy the next space-separated word into out; returns its length */
+int shell_word(const char **p, char *out, int max);
+int shell_int(const char *s);
+
+/* for a handler run as a pipeline stage: claim its pipe ends (pipe.h), -1
+   where there is none. Claimed ends are the handler's to close; ends left
+   unclaimed are closed by the shell when the handler returns. */
+void shell_take_pipes(int *in, int *out);
+
+#endif
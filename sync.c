@@ -1,7 +1,10 @@
 #include "sync.h"
 #include "uart.h"
 
-/* Tiny cooperative mutex/semaphore helpers. Busy-wait with yields. */
+/* Tiny cooperative mutex/semaphore helpers. Waiters block on the object's
+   address and are woken by unlock/post; with priorities a busy-waiting
+   high-priority thread would starve the one it waits for. A mutex waiter
+   lends its priority to the owner. */
 
 void mutex_init(mutex_t *m) {
     if (!m) return;
@@ -13,26 +16,23 @@ int mutex_trylock(mutex_t *m) {
     if (!m) return -1;
     if (m->locked) return -1;
     m->locked = 1;
-    m->owner = 0;
+    m->owner = thread_self();
     return 0;
 }
 
 void mutex_lock(mutex_t *m) {
     if (!m) return;
-    while (1) {
-        if (!m->locked) {
-            m->locked = 1;
-            m->owner = 0;
-            return;
-        }
-        thread_yield();
-    }
+    while (m->locked) thread_block_on(m, m->owner);
+    m->locked = 1;
+    m->owner = thread_self();
 }
 
 void mutex_unlock(mutex_t *m) {
     if (!m) return;
     m->locked = 0;
     m->owner = 0;
+    /* every waiter retries; the highest priority one runs first and wins */
+    thread_wake(m);
 }
 
 void sem_init(semaphore_t *s, int initial) {
@@ -43,12 +43,13 @@ void sem_init(semaphore_t *s, int initial) {
 void sem_post(semaphore_t *s) {
     if (!s) return;
     s->count++;
+    thread_wake(s);
 }
 
 void sem_wait(semaphore_t *s) {
     if (!s) return;
     while (s->count <= 0) {
-        thread_yield();
+        thread_block(s);
     }
     s->count--;
 }
@@ -68,9 +69,10 @@ void barrier_wait(barrier_t *b) {
     if (b->count >= b->needed) {
         b->count = 0;
         b->generation++;
+        thread_wake(b);
         return;
     }
     while (b->generation == my_gen) {
-        thread_yield();
+        thread_block(b);
     }
 }
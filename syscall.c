@@ -0,0 +1,154 @@
+#include "syscall.h"
+#include "trap.h"
+#include "ring.h"
+#include "prog.h"
+#include "vm.h"
+#include "fs.h"
+#include "apps.h"
+#include "thread.h"
+#include "string.h"
+#include "uart.h"
+#include "console.h"
+#include "ioring.h"
+#include <stddef.h>
+
+/* System calls from native user programs, by trap or from an io ring
+   (ring.c). User pointers are never dereferenced directly: every buffer
+   goes through vm_copyin/vm_copyout, which translate it through the
+   caller's own page table, so a bad pointer fails the call instead of
+   faulting the kernel. */
+
+typedef long (*syscall_fn)(const sys_caller *who, const unsigned long *a);
+
+/* fs and uart calls never yield, so one bounce buffer serves everyone */
+static char bounce[FS_DATA_LEN];
+
+/* NUL-terminated user string into out; -1 if unmapped or too long */
+static int copy_str(vm_space *vs, unsigned long uva, char *out, int max) {
+    for (int i = 0; i < max; ++i) {
+        if (vm_copyin(vs, &out[i], uva + i, 1) < 0) return -1;
+        if (out[i] == '\0') return 0;
+    }
+    return -1;
+}
+
+/* a trapping program is stopped; a ring call just fails */
+static long over_quota(const sys_caller *who, const char *what) {
+    if (who->in_trap) prog_self_quota(what);
+    return IORING_EQUOTA;
+}
+
+static long sys_exit(const sys_caller *who, const unsigned long *a) {
+    (void)who;
+    prog_self_exit((int)a[0], NULL);
+}
+
+static long sys_write(const sys_caller *who, const unsigned long *a) {
+    unsigned long len = a[1];
+    if (len > sizeof(bounce) - 1) len = sizeof(bounce) - 1;
+    if (vm_copyin(who->vs, bounce, a[0], len) < 0) return -1;
+    for (unsigned long i = 0; i < len; ++i) uart_putc(bounce[i]);
+    return (long)len;
+}
+
+static long sys_read(const sys_caller *who, const unsigned long *a) {
+    /* whatever console input is buffered, without blocking */
+    unsigned long n = 0;
+    int c;
+    while (n < a[1] && n < sizeof(bounce) && (c = console_trygetc()) >= 0) bounce[n++] = (char)c;
+    if (vm_copyout(who->vs, a[0], bounce, n) < 0) return -1;
+    return (long)n;
+}
+
+static long sys_yield(const sys_caller *who, const unsigned long *a) {
+    (void)who; (void)a;
+    thread_yield();
+    return 0;
+}
+
+static long sys_sleep(const sys_caller *who, const unsigned long *a) {
+    (void)who;
+    thread_sleep((long)a[0] > 0 ? (int)a[0] : 1);
+    return 0;
+}
+
+static long sys_spawn(const sys_caller *who, const unsigned long *a) {
+    char name[32];
+    if (copy_str(who->vs, a[0], name, sizeof(name)) < 0) return -1;
+    const char *over = prog_charge(who->tid, PROG_CHARGE_SPAWN, 1);
+    if (over) return over_quota(who, over);
+    return app_spawn(name);
+}
+
+static long sys_fs_read(const sys_caller *who, const unsigned long *a) {
+    char name[FS_NAME_LEN];
+    if (copy_str(who->vs, a[0], name, sizeof(name)) < 0) return -1;
+    unsigned long max = a[2] < sizeof(bounce) ? a[2] : sizeof(bounce);
+    int n = fs_read_buf(name, bounce, (int)max);
+    if (n < 0) return -1;
+    if (vm_copyout(who->vs, a[1], bounce, (unsigned long)n) < 0) return -1;
+    prog_charge(who->tid, PROG_CHARGE_RBYTES, (unsigned long)n);
+    return n;
+}
+
+static long sys_fs_write(const sys_caller *who, const unsigned long *a) {
+    char name[FS_NAME_LEN];
+    if (copy_str(who->vs, a[0], name, sizeof(name)) < 0) return -1;
+    if (a[2] > sizeof(bounce)) return -1;
+    if (vm_copyin(who->vs, bounce, a[1], a[2]) < 0) return -1;
+    const char *over = prog_charge(who->tid, PROG_CHARGE_WBYTES, a[2]);
+    if (over) return over_quota(who, over);
+    return fs_write_buf(name, bounce, (int)a[2]);
+}
+
+static long sys_fs_delete(const sys_caller *who, const unsigned long *a) {
+    char name[FS_NAME_LEN];
+    if (copy_str(who->vs, a[0], name, sizeof(name)) < 0) return -1;
+    return fs_delete(name);
+}
+
+static long sys_ring_setup(const sys_caller *who, const unsigned long *a) {
+    return ring_setup(who, a[0]);
+}
+
+static long sys_ring_enter(const sys_caller *who, const unsigned long *a) {
+    (void)a;
+    return ring_enter(who);
+}
+
+static const struct {
+    syscall_fn fn;
+    int cap;  /* CAP_* required, 0 = always allowed */
+    int ring; /* never blocks: may be submitted through an io ring */
+} syscalls[SYS_COUNT] = {
+    [SYS_EXIT] = { sys_exit, 0, 0 },
+    [SYS_WRITE] = { sys_write, CAP_UART, 1 },
+    [SYS_READ] = { sys_read, CAP_UART, 0 },
+    [SYS_YIELD] = { sys_yield, 0, 0 },
+    [SYS_SLEEP] = { sys_sleep, 0, 0 },
+    [SYS_SPAWN] = { sys_spawn, CAP_SPAWN, 0 },
+    [SYS_FS_READ] = { sys_fs_read, CAP_FS_R, 1 },
+    [SYS_FS_WRITE] = { sys_fs_write, CAP_FS_W, 1 },
+    [SYS_FS_DELETE] = { sys_fs_delete, CAP_FS_W, 1 },
+    [SYS_RING_SETUP] = { sys_ring_setup, 0, 0 },
+    [SYS_RING_ENTER] = { sys_ring_enter, 0, 0 },
+};
+
+long syscall_run(const sys_caller *who, unsigned long nr, const unsigned long *args, int ring_only) {
+    if (nr >= SYS_COUNT || (syscalls[nr].cap & ~who->caps)) return -1;
+    if (ring_only && !syscalls[nr].ring) return -1;
+    return syscalls[nr].fn(who, args);
+}
+
+void syscall_dispatch(trapframe *tf) {
+    sys_caller who;
+    who.tid = thread_self();
+    who.vs = prog_self_vm();
+    who.caps = prog_self_caps();
+    who.in_trap = 1;
+    /* counts as one op for the ops/s quota; also checks the cpu quota */
+    const char *over = prog_charge(who.tid, PROG_CHARGE_OP, 1);
+    if (over) prog_self_quota(over);
+    const unsigned long args[3] = { tf->a0, tf->a1, tf->a2 };
+    tf->a0 = (unsigned long)syscall_run(&who, tf->a7, args, 0);
+}
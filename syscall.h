@@ -0,0 +1,20 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+/* System call numbers, shared with user programs (user/ulib.c).
+   Calling convention: a7 = number, a0..a5 = arguments, result in a0
+   (negative on failure). Each call needs the capability noted. */
+#define SYS_EXIT       0  /* exit(code) */
+#define SYS_WRITE      1  /* write(buf, len) to the UART       CAP_UART */
+#define SYS_READ       2  /* read(buf, max) from the UART      CAP_UART */
+#define SYS_YIELD      3  /* yield() */
+#define SYS_SLEEP      4  /* sleep(ticks) */
+#define SYS_SPAWN      5  /* spawn(app name) -> tid            CAP_SPAWN */
+#define SYS_FS_READ    6  /* fs_read(name, buf, max) -> len    CAP_FS_R */
+#define SYS_FS_WRITE   7  /* fs_write(name, buf, len)          CAP_FS_W */
+#define SYS_FS_DELETE  8  /* fs_delete(name)                   CAP_FS_W */
+#define SYS_RING_SETUP 9  /* ring_setup(flags) -> ring address (ioring.h) */
+#define SYS_RING_ENTER 10 /* ring_enter() -> completions posted */
+#define SYS_COUNT      11
+
+#endif
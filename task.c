@@ -0,0 +1,185 @@
+#include "task.h"
+#include "thread.h"
+#include "riscv.h"
+#include <stddef.h>
+
+enum { T_FREE = 0, T_READY, T_WAIT };
+
+static task_t pool[TASK_MAX];
+static task_t *free_list;
+static int pool_ready; /* free_list built */
+static int live;
+static task_list ready;
+/* sleeping tasks, min-heap on wake */
+static task_t *heap[TASK_MAX];
+static int nheap;
+static tid_t runner; /* 0 = runtime thread not running */
+
+static void list_push(task_list *l, task_t *t) {
+    t->next = NULL;
+    if (l->tail) l->tail->next = t;
+    else l->head = t;
+    l->tail = t;
+}
+
+static task_t *list_pop(task_list *l) {
+    task_t *t = l->head;
+    if (!t) return NULL;
+    l->head = t->next;
+    if (!l->head) l->tail = NULL;
+    t->next = NULL;
+    return t;
+}
+
+static void make_ready(task_t *t) {
+    t->state = T_READY;
+    list_push(&ready, t);
+}
+
+static void heap_push(task_t *t) {
+    int i = nheap++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent]->wake <= t->wake) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = t;
+}
+
+static task_t *heap_pop(void) {
+    task_t *top = heap[0];
+    task_t *last = heap[--nheap];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= nheap) break;
+        if (c + 1 < nheap && heap[c + 1]->wake < heap[c]->wake) c++;
+        if (last->wake <= heap[c]->wake) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    if (nheap > 0) heap[i] = last;
+    return top;
+}
+
+/* the runtime thread: expired timers first, then one batch of ready tasks.
+   It sleeps until the earliest timer when only timers are pending and exits
+   when no task is left. */
+static int task_runner(void *unused) {
+    (void)unused;
+    while (live > 0) {
+        unsigned long now = r_time();
+        while (nheap > 0 && heap[0]->wake <= now) make_ready(heap_pop());
+        int ran = 0;
+        task_t *t;
+        while (ran < TASK_BATCH && (t = list_pop(&ready)) != NULL) {
+            ran++;
+            switch (t->fn(t)) {
+            case TASK_DONE:
+                t->state = T_FREE;
+                t->next = free_list;
+                free_list = t;
+                live--;
+                break;
+            case TASK_AGAIN:
+                make_ready(t);
+                break;
+            default:
+                /* TASK_BLOCKED: parked on a timer or wait list */
+                t->state = T_WAIT;
+                break;
+            }
+        }
+        if (ran == 0 && nheap > 0) thread_sleep_until(heap[0]->wake);
+        else if (ran == 0) thread_sleep(1);
+        else thread_yield();
+    }
+    runner = 0;
+    return 0;
+}
+
+task_t *task_spawn(task_fn fn, void *arg) {
+    if (!pool_ready) {
+        for (int i = TASK_MAX - 1; i >= 0; --i) {
+            pool[i].next = free_list;
+            free_list = &pool[i];
+        }
+        pool_ready = 1;
+    }
+    if (!free_list) return NULL;
+    if (!runner || !thread_exists(runner)) {
+        runner = thread_spawn(task_runner, NULL, "tasks");
+        if (runner < 0) {
+            runner = 0;
+            return NULL;
+        }
+    }
+    task_t *t = free_list;
+    free_list = t->next;
+    t->fn = fn;
+    t->arg = arg;
+    t->local[0] = t->local[1] = 0;
+    t->wake = 0;
+    t->lc = 0;
+    live++;
+    make_ready(t);
+    return t;
+}
+
+int task_count(void) {
+    return live;
+}
+
+void task_sleep_ms(task_t *t, unsigned long ms) {
+    t->wake = r_time() + ms * (TIMEBASE_HZ / 1000);
+    heap_push(t);
+}
+
+void task_sem_init(task_sem_t *s, int count) {
+    s->count = count;
+    s->waiters.head = s->waiters.tail = NULL;
+}
+
+void task_sem_post(task_sem_t *s) {
+    s->count++;
+    task_t *t = list_pop(&s->waiters);
+    if (t) make_ready(t);
+}
+
+int task_sem_take(task_t *t, task_sem_t *s) {
+    if (s->count > 0) {
+        s->count--;
+        return 1;
+    }
+    list_push(&s->waiters, t);
+    return 0;
+}
+
+void task_chan_init(task_chan_t *c) {
+    c->head = c->tail = 0;
+    c->senders.head = c->senders.tail = NULL;
+    c->receivers.head = c->receivers.tail = NULL;
+}
+
+int task_chan_put(task_t *t, task_chan_t *c, void *v) {
+    if (c->tail - c->head >= TASK_CHAN_CAP) {
+        list_push(&c->senders, t);
+        return 0;
+    }
+    c->buf[c->tail++ % TASK_CHAN_CAP] = v;
+    task_t *r = list_pop(&c->receivers);
+    if (r) make_ready(r);
+    return 1;
+}
+
+int task_chan_get(task_t *t, task_chan_t *c, void **v) {
+    if (c->head == c->tail) {
+        list_push(&c->receivers, t);
+        return 0;
+    }
+    *v = c->buf[c->head++ % TASK_CHAN_CAP];
+    task_t *s = list_pop(&c->senders);
+    if (s) make_ready(s);
+    return 1;
+}
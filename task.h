@@ -0,0 +1,107 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "aio.h"
+
+/* Stackless tasks: protothread-style state machines multiplexed on one
+   kernel thread ("tasks"), started on demand like the aio worker. A task
+   is a function that runs from its last wait point to the next one and
+   returns; it costs sizeof(task_t) instead of a thread slot and a stack.
+
+   Locals do not survive a wait: keep state in task->arg or task->local.
+   Waits may only appear directly in the task function, between TASK_BEGIN
+   and TASK_END (they expand to case labels of one switch).
+
+       static int ticker(task_t *t) {
+           TASK_BEGIN(t);
+           for (t->local[0] = 0; t->local[0] < 5; t->local[0]++) {
+               TASK_SLEEP_MS(t, 100);
+               TASK_CHAN_SEND(t, &chan, t->arg);
+           }
+           TASK_END(t);
+       }
+*/
+
+#define TASK_MAX 2048    /* tasks alive at once */
+#define TASK_BATCH 64    /* tasks run per turn before the runtime yields */
+#define TASK_CHAN_CAP 8  /* messages a channel buffers */
+
+typedef struct task task_t;
+typedef int (*task_fn)(task_t *t);
+
+/* what a task function returns (the macros do this) */
+enum { TASK_DONE = 0, TASK_AGAIN, TASK_BLOCKED };
+
+struct task {
+    task_fn fn;
+    void *arg;
+    long local[2];      /* scratch that survives waits */
+    unsigned long wake; /* rdtime deadline while sleeping */
+    task_t *next;       /* ready queue / wait list / free list */
+    unsigned short lc;  /* resume point (a wait's case label) */
+    unsigned char state;
+};
+
+typedef struct {
+    task_t *head, *tail;
+} task_list;
+
+typedef struct {
+    int count;
+    task_list waiters;
+} task_sem_t;
+
+typedef struct {
+    void *buf[TASK_CHAN_CAP];
+    unsigned int head, tail;
+    task_list senders, receivers;
+} task_chan_t;
+
+/* NULL when the pool is full or the runtime thread can't start */
+task_t *task_spawn(task_fn fn, void *arg);
+/* tasks alive */
+int task_count(void);
+
+void task_sem_init(task_sem_t *s, int count);
+/* usable from tasks and ordinary threads alike */
+void task_sem_post(task_sem_t *s);
+void task_chan_init(task_chan_t *c);
+
+/* helpers behind the macros */
+void task_sleep_ms(task_t *t, unsigned long ms);
+int task_sem_take(task_t *t, task_sem_t *s);
+int task_chan_put(task_t *t, task_chan_t *c, void *v);
+int task_chan_get(task_t *t, task_chan_t *c, void **v);
+
+#define TASK_BEGIN(t) switch ((t)->lc) { case 0:
+#define TASK_END(t) } (t)->lc = 0; return TASK_DONE
+
+/* every wait point is a case label; __COUNTER__ + 1 keeps them unique
+   (and nonzero) even with several waits on one line. PARK arms a wakeup
+   and returns once; RETRY parks until ok succeeds; POLL re-runs each turn. */
+#define TASK_PARK_AT_(t, arm, n) \
+    do { arm; (t)->lc = (n); return TASK_BLOCKED; case (n):; } while (0)
+#define TASK_RETRY_AT_(t, ok, n) \
+    do { (t)->lc = (n); case (n): if (!(ok)) return TASK_BLOCKED; } while (0)
+#define TASK_POLL_AT_(t, cond, n) \
+    do { (t)->lc = (n); case (n): if (!(cond)) return TASK_AGAIN; } while (0)
+#define TASK_YIELD_AT_(t, n) \
+    do { (t)->lc = (n); return TASK_AGAIN; case (n):; } while (0)
+
+/* let the other ready tasks run */
+#define TASK_YIELD(t) TASK_YIELD_AT_(t, __COUNTER__ + 1)
+/* poll cond once per runtime turn */
+#define TASK_WAIT_UNTIL(t, cond) TASK_POLL_AT_(t, cond, __COUNTER__ + 1)
+/* park on the timer heap */
+#define TASK_SLEEP_MS(t, ms) TASK_PARK_AT_(t, task_sleep_ms((t), (ms)), __COUNTER__ + 1)
+/* retry the take/put each time the task is woken until it succeeds */
+#define TASK_SEM_WAIT(t, s) TASK_RETRY_AT_(t, task_sem_take((t), (s)), __COUNTER__ + 1)
+#define TASK_CHAN_SEND(t, c, v) TASK_RETRY_AT_(t, task_chan_put((t), (c), (v)), __COUNTER__ + 1)
+/* out must be an lvalue that survives waits (e.g. a field of t->arg) */
+#define TASK_CHAN_RECV(t, c, out) \
+    TASK_RETRY_AT_(t, task_chan_get((t), (c), (void **)&(out)), __COUNTER__ + 1)
+/* wait for an aio request, release it and store its result in res */
+#define TASK_AWAIT_IO(t, h, res) \
+    do { TASK_WAIT_UNTIL(t, aio_poll((h), NULL) != 0); (res) = aio_wait(h); } while (0)
+
+#endif
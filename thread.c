@@ -1,42 +1,82 @@
+#include "config.h"
 #include "thread.h"
 #include "uart.h"
 #include "string.h"
+#include "riscv.h"
+#include "timer.h"
+#include "trap.h"
+#include "fpu.h"
 #include <stddef.h>
 
 /* Cooperative threading: fixed-size table and static stacks. */
 
-#define MAX_THREADS 16
-#define STACK_SIZE 4096
-void thread_exit(void);
+#define MAX_THREADS CONFIG_MAX_THREADS
+#define STACK_SIZE CONFIG_STACK_SIZE
+#define CTX_REGS 15 /* ra, sp, s0-s11, satp (see context.S) */
+#define REAP_BATCH 4 /* unjoined finished threads the idle loop lets pile up */
+#define AGE_STEP 4 /* switches a normal thread waits per level it is raised */
+#define STACK_PAINT 0xa5 /* fill of unused stack, for the high-water mark */
 
 enum {
     THREAD_READY = 0,
     THREAD_RUNNING = 1,
-    THREAD_FINISHED = 2,
-    THREAD_SLEEPING = 3
+    THREAD_FINISHED = 2, /* zombie: slot and stack held until joined or reaped */
+    THREAD_SLEEPING = 3,
+    THREAD_BLOCKED = 4
 };
 
+#define TICK_TIME (TIMEBASE_HZ / 1000 * THREAD_TICK_MS)
+
+_Static_assert(MAX_THREADS >= 2, "the idle thread needs company");
+_Static_assert(STACK_SIZE >= 2048 && STACK_SIZE % 16 == 0, "stacks hold trap frames and keep sp 16-byte aligned");
+
 typedef struct {
     int used;
     tid_t id;
     char name[16];
-    unsigned long regs[14]; /* saved context: ra, sp, s0-s11 */
+    unsigned long regs[CTX_REGS]; /* saved context: ra, sp, s0-s11, satp (0 = any) */
     thread_fn fn;
     void *arg;
     int state; /* THREAD_* */
-    int sleep_ticks; /* remaining ticks if sleeping */
+    unsigned long wake_at; /* rdtime deadline if sleeping */
+    const void *wait_chan; /* what it is blocked on */
+    unsigned long run_start; /* rdtime when last switched in */
+    unsigned long cpu_time;  /* accumulated rdtime ticks spent running */
+    unsigned long since;     /* rdtime at its last scheduling point */
+    unsigned long longest;   /* longest stretch between two of them */
+    int status;    /* exit status once finished */
+    tid_t joiner;  /* thread blocked in thread_join on this one, 0 = none */
+    int killed;    /* exit at the next switch point */
+    int interrupted; /* thread_interrupt: its thread_join gives up */
+    int prio;      /* base priority, THREAD_PRIO_MIN..THREAD_PRIO_MAX */
+    int eprio;     /* prio raised by inheritance (see update_eprio) */
+    tid_t wait_owner; /* holder of what it is blocked on, 0 = none */
+    int age;       /* switches passed over while ready (normal class) */
+    unsigned long affinity; /* harts it may run on, bit n = hart n */
+    fpu_state fpu; /* f0-f31/fcsr while another thread owns the FPU (fpu.c) */
 } thread_t;
 
 static thread_t threads[MAX_THREADS];
 /* per-thread stacks that will be used for SP initialization */
 static unsigned char stacks[MAX_THREADS][STACK_SIZE];
 
+/* slot of the idle thread: the boot context, run only when nothing else
+   is ready */
+#define IDLE 0
+
+/* the boot stack (linker.ld), which the idle thread keeps */
+extern unsigned char _stack_bottom[], _stack_top[];
+
 static tid_t next_tid = 1;
-static int cur = -1; /* current running thread index, -1 = main */
+static int cur = IDLE; /* current running thread index */
+static unsigned long next_wake = TIMER_NEVER; /* earliest sleeper deadline */
+static int zombies; /* finished threads not yet joined or reaped */
+static int ncpus = 1; /* harts scheduling threads; only the boot hart so far */
 
-/* persistent storage for the shell/main context so we can restore it */
-static unsigned long main_regs[14];
-static int main_saved = 0; /* whether main_regs currently holds saved state */
+/* hart the scheduler is running on */
+static int cpu_id(void) {
+    return 0;
+}
 
 /* context switch implemented in assembly (defined in context.S) */
 void context_switch(unsigned long *old_regs, unsigned long *new_regs);
@@ -44,213 +84,258 @@ void context_switch(unsigned long *old_regs, unsigned long *new_regs);
 /* trampoline implemented in C (thread_trampoline.c) */
 extern void thread_trampoline(void);
 
+/* CPU accounting at every switch */
+static void account(int prev, int next) {
+    unsigned long now = r_time();
+    threads[prev].cpu_time += now - threads[prev].run_start;
+    threads[next].run_start = now;
+    threads[next].since = now;
+}
+
+void thread_init(void) {
+    threads[IDLE].used = 1;
+    threads[IDLE].id = 0;
+    threads[IDLE].state = THREAD_RUNNING;
+    threads[IDLE].prio = threads[IDLE].eprio = THREAD_PRIO_MIN;
+    threads[IDLE].affinity = 1UL << cpu_id();
+    strlcpy(threads[IDLE].name, "idle", sizeof(threads[IDLE].name));
+    threads[IDLE].run_start = threads[IDLE].since = r_time();
+    cur = IDLE;
+    fpu_init();
+    /* paint the boot stack below our frame, with room for the calls ahead */
+    unsigned char *sp = (unsigned char *)__builtin_frame_address(0) - 512;
+    memset(_stack_bottom, STACK_PAINT, (unsigned long)(sp - _stack_bottom));
+}
+
+/* scheduling rank: real-time threads by effective priority alone; normal
+   ones also by how long they have been passed over, capped below the
+   real-time class, so low priorities still make progress */
+static int rank(const thread_t *t) {
+    if (t->eprio >= THREAD_PRIO_RT) return t->eprio;
+    int r = t->eprio + t->age / AGE_STEP;
+    return r < THREAD_PRIO_RT ? r : THREAD_PRIO_RT - 1;
+}
+
+/* best-ranked ready thread allowed on this hart, round-robin among equals
+   starting after cur; idle if none */
+static int pick_next(void) {
+    unsigned long me = 1UL << cpu_id();
+    int best = IDLE, best_rank = -1;
+    for (int i = 1; i <= MAX_THREADS; ++i) {
+        int idx = (cur + i) % MAX_THREADS;
+        const thread_t *t = &threads[idx];
+        if (idx == IDLE || !t->used || t->state != THREAD_READY || !(t->affinity & me)) continue;
+        int r = rank(t);
+        if (r > best_rank) {
+            best = idx;
+            best_rank = r;
+        }
+    }
+    return best;
+}
+
+static void switch_to(int next) {
+    int prev = cur;
+    threads[next].state = THREAD_RUNNING;
+    threads[next].age = 0;
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        thread_t *t = &threads[i];
+        if (t->used && t->state == THREAD_READY && t->eprio < THREAD_PRIO_RT) t->age++;
+    }
+    if (next == prev) {
+        threads[cur].since = r_time();
+        return;
+    }
+    cur = next;
+    account(prev, next);
+    /* idle arms the timer itself; a thread gets the next sample or sleeper
+       (cheap when that deadline is already armed) */
+    if (next != IDLE) timer_sample_arm();
+    fpu_switch(&threads[next].fpu);
+    context_switch(threads[prev].regs, threads[next].regs);
+    /* resumed: a kill that arrived while we were switched out lands here */
+    if (threads[cur].killed) thread_exit(THREAD_KILLED);
+}
+
 void thread_start_run(void) {
-    uart_puts("[thread_start_run] enter\n");
+    uart_trace("[thread_start_run] enter\n");
 
-    if (cur < 0 || cur >= MAX_THREADS || !threads[cur].used) {
+    if (cur == IDLE || !threads[cur].used) {
         uart_puts("[thread_start_run] ERROR: no current thread\n");
         /* nothing sensible to do — halt */
         while (1) asm volatile("wfi");
     }
 
-    /* mark running */
+    /* mark running; a new thread starts out of a switch, which had
+       interrupts off */
     threads[cur].state = THREAD_RUNNING;
+    if (trap_kernel_intr_on()) intr_restore(SSTATUS_SIE);
+    if (threads[cur].killed) thread_exit(THREAD_KILLED);
 
-    /* call the thread function */
+    /* call the thread function; what it returns is the exit status */
+    int status = 0;
     if (threads[cur].fn) {
-        /* thread_fn has signature void(*)(void*), apps cast to that when spawned */
-        threads[cur].fn(threads[cur].arg);
+        status = threads[cur].fn(threads[cur].arg);
     }
 
-    uart_puts("[thread_start_run] thread fn returned\n");
-    uart_puts("[thread_start_run] about to clean up / exit\n");
-    uart_puts("[thread_start_run] call thread_exit()\n");
-    thread_exit();
+    uart_trace("[thread_start_run] thread fn returned\n");
+    uart_trace("[thread_start_run] about to clean up / exit\n");
+    uart_trace("[thread_start_run] call thread_exit()\n");
+    thread_exit(status);
 
     /* should never get here */
     uart_puts("[thread_start_run] ERROR: returned from thread_exit\n");
     while (1) asm volatile("wfi");
 }
 
-void thread_exit(void) {
-    if (cur == -1) {
-        uart_puts("[thread_exit] ERROR: thread_exit called with no current thread\n");
-        while (1) asm volatile("wfi");
-    }
-
-    int prev = cur;
-    threads[prev].state = THREAD_FINISHED; /* mark finished */
-    uart_puts("[thread_exit] thread marked finished\n");
+static thread_exit_hook exit_hook;
 
-    /* find next ready thread */
-    int next = -1;
-    for (int i = 1; i <= MAX_THREADS; ++i) {
-        int idx = (prev + i) % MAX_THREADS;
-        if (threads[idx].used && threads[idx].state == THREAD_READY) { next = idx; break; }
-    }
+void thread_set_exit_hook(thread_exit_hook fn) {
+    exit_hook = fn;
+}
 
-    if (next != -1) {
-        /* switch directly to next ready thread (never returns) */
-        uart_puts("[thread_exit] switching to next ready thread\n");
-        cur = next;
-        context_switch(threads[prev].regs, threads[cur].regs);
-        /* never returns */
+void thread_exit(int status) {
+    if (cur == IDLE) {
+        uart_puts("[thread_exit] ERROR: the idle thread cannot exit\n");
         while (1) asm volatile("wfi");
     }
+    /* still a live thread: its owner can look up its CPU time and state */
+    if (exit_hook) exit_hook(threads[cur].id, status);
+
+    /* keep the slot as a zombie holding the status; a joiner frees it, or
+       the reaper once we are switched away and off this stack. The next
+       thread restores its own interrupt state. */
+    intr_off();
+    threads[cur].state = THREAD_FINISHED;
+    threads[cur].status = status;
+    fpu_drop(&threads[cur].fpu);
+    zombies++;
+    uart_trace("[thread_exit] thread marked finished\n");
+    thread_wake(&threads[cur]);
+    switch_to(pick_next());
 
-    /* no other ready thread: restore main if saved, otherwise spin */
-    cur = -1;
-    if (main_saved) {
-        uart_puts("[thread_exit] restoring main context\n");
-        main_saved = 0;
-        context_switch(threads[prev].regs, main_regs);
-        /* when/if this returns, we're back in main */
-        return;
-    }
-
-    /* nothing to run and main not saved -> idle forever */
-    uart_puts("[thread_exit] no threads left, halting\n");
+    /* should never get here */
+    uart_puts("[thread_exit] ERROR: finished thread resumed\n");
     while (1) asm volatile("wfi");
 }
 
-tid_t thread_spawn(thread_fn fn, void *arg, const char *name) {
+/* recycle the slots (TCB and stack) of finished threads nobody is joining;
+   never the running thread, whose stack is still in use */
+static void reap(void) {
     for (int i = 0; i < MAX_THREADS; ++i) {
-        if (!threads[i].used) {
-            threads[i].used = 1;
-            threads[i].id = next_tid++;
-            threads[i].fn = fn;
-            threads[i].arg = arg;
-            threads[i].state = THREAD_READY;
-            threads[i].sleep_ticks = 0;
-            /* copy name safely */
-            int j;
-            for (j = 0; j < 15 && name && name[j]; ++j) threads[i].name[j] = name[j];
-            threads[i].name[j] = '\0';
-            /* clear saved registers */
-            for (int r = 0; r < 14; ++r) threads[i].regs[r] = 0;
-            /* set ra to trampoline so when context restores it will jump into trampoline */
-            threads[i].regs[0] = (unsigned long)thread_trampoline; /* ra */
-            /* set sp to top of the thread's dedicated stack */
-            threads[i].regs[1] = (unsigned long)&stacks[i][STACK_SIZE];
-            return threads[i].id;
-        }
+        thread_t *t = &threads[i];
+        if (i == cur || !t->used || t->state != THREAD_FINISHED) continue;
+        if (t->joiner && thread_exists(t->joiner)) continue;
+        t->used = 0;
+        zombies--;
     }
-    return -1;
 }
 
-static int find_idx_by_tid(tid_t tid) {
+static int free_slot(void) {
     for (int i = 0; i < MAX_THREADS; ++i) {
-        if (threads[i].used && threads[i].id == tid) return i;
+        if (!threads[i].used) return i;
     }
     return -1;
 }
 
-/* cooperative yield: switch to next ready thread or return to main if none */
-void thread_yield(void) {
-    int old = cur;
-    int next = -1;
-    for (int i = 1; i <= MAX_THREADS; ++i) {
-        int idx = (old + i) % MAX_THREADS;
-        if (threads[idx].used && threads[idx].state == THREAD_READY) { next = idx; break; }
-    }
+tid_t thread_spawn(thread_fn fn, void *arg, const char *name) {
+    return thread_spawn_prio(fn, arg, name, THREAD_PRIO_DEFAULT);
+}
 
-    /* If there is a next ready thread, do a normal switch (or start it). */
-    if (next != -1) {
-        if (old == -1) {
-            /* yielding from main into a thread */
-            cur = next;
-            threads[cur].state = THREAD_RUNNING;     /* mark as running */
-            main_saved = 1;
-            context_switch(main_regs, threads[cur].regs);
-            return;
-        } else {
-            int prev = old;
-            /* mark prev as ready, next as running */
-            if (threads[prev].state == THREAD_RUNNING) {
-                threads[prev].state = THREAD_READY;
-            }
-            cur = next;
-            threads[cur].state = THREAD_RUNNING;
-            context_switch(threads[prev].regs, threads[cur].regs);
-            return;
-        }
+tid_t thread_spawn_prio(thread_fn fn, void *arg, const char *name, int prio) {
+    if (prio < THREAD_PRIO_MIN || prio > THREAD_PRIO_MAX) return -1;
+    int i = free_slot();
+    if (i < 0 && zombies > 0) {
+        reap();
+        i = free_slot();
     }
+    if (i < 0) return -1;
+    threads[i].used = 1;
+    threads[i].id = next_tid++;
+    threads[i].fn = fn;
+    threads[i].arg = arg;
+    threads[i].state = THREAD_READY;
+    threads[i].wake_at = 0;
+    threads[i].wait_chan = NULL;
+    threads[i].cpu_time = 0;
+    threads[i].longest = 0;
+    threads[i].status = 0;
+    threads[i].joiner = 0;
+    threads[i].killed = 0;
+    threads[i].interrupted = 0;
+    threads[i].prio = threads[i].eprio = prio;
+    threads[i].wait_owner = 0;
+    threads[i].age = 0;
+    threads[i].affinity = THREAD_CPU_ALL;
+    fpu_drop(&threads[i].fpu);
+    /* copy name safely */
+    int j;
+    for (j = 0; j < 15 && name && name[j]; ++j) threads[i].name[j] = name[j];
+    threads[i].name[j] = '\0';
+    memset(stacks[i], STACK_PAINT, STACK_SIZE);
+    /* clear saved registers */
+    for (int r = 0; r < CTX_REGS; ++r) threads[i].regs[r] = 0;
+    /* set ra to trampoline so when context restores it will jump into trampoline */
+    threads[i].regs[0] = (unsigned long)thread_trampoline; /* ra */
+    /* set sp to top of the thread's dedicated stack */
+    threads[i].regs[1] = (unsigned long)&stacks[i][STACK_SIZE];
+    return threads[i].id;
+}
 
-    /* No other ready thread found. If we're a thread (old != -1) we should
-       restore main (if it was saved). In this case mark the yielding thread
-       back to READY so it can be scheduled later. */
-    if (old != -1) {
-        int prev = old;
-        /* mark thread no longer running, back to ready */
-        if (threads[prev].state == THREAD_RUNNING) {
-            threads[prev].state = THREAD_READY;
-        }
-
-        cur = -1;
-        if (main_saved) {
-            /* restore saved main registers so the shell resumes */
-            main_saved = 0;
-            context_switch(threads[prev].regs, main_regs);
-            /* when this returns, execution is back in main */
-            return;
-        }
-        /* if main wasn't saved, simply return (nothing to switch to) */
+static int find_idx_by_tid(tid_t tid) {
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (threads[i].used && threads[i].id == tid) return i;
     }
-
-    /* old == -1 and no ready threads: nothing to do */
-    return;
+    return -1;
 }
 
-/* scheduler tick: start a thread if none running, or cleanup finished ones */
-void sched_tick(void) {
-    /* wake sleeping threads and move them back to ready when their timer hits 0 */
+/* move sleepers whose deadline passed back to ready; returns the earliest
+   deadline still pending (TIMER_NEVER if none) */
+static unsigned long wake_sleepers(void) {
+    unsigned long now = r_time();
+    unsigned long next = TIMER_NEVER;
     for (int i = 0; i < MAX_THREADS; ++i) {
         if (threads[i].used && threads[i].state == THREAD_SLEEPING) {
-            if (threads[i].sleep_ticks > 0) threads[i].sleep_ticks--;
-            if (threads[i].sleep_ticks <= 0) threads[i].state = THREAD_READY;
+            if (threads[i].wake_at <= now) threads[i].state = THREAD_READY;
+            else if (threads[i].wake_at < next) next = threads[i].wake_at;
         }
     }
+    next_wake = next;
+    timer_wake_at(next);
+    return next;
+}
 
-    if (cur == -1) {
-        /* pick a ready thread to run, if any */
-        for (int i = 0; i < MAX_THREADS; ++i) {
-            if (threads[i].used && threads[i].state == THREAD_READY) {
-                /* start this thread; if main hasn't been saved, save it */
-                cur = i;
-		threads[cur].state = THREAD_RUNNING; /* mark as running */
-		if (!main_saved) {
-		    main_saved = 1;
-		    context_switch(main_regs, threads[cur].regs);
-		} else {
-    		    unsigned long dummy[14] = {0};
-		    context_switch(dummy, threads[cur].regs);
-		}
-
-                break;
-            }
-        }
-    } else {
-        /* if current thread finished, free it and restore main if needed */
-        if (threads[cur].state == THREAD_FINISHED) {
-            int finished = cur;
-            /* clear the thread slot */
-            threads[finished].used = 0;
-            cur = -1;
-            if (main_saved) {
-                main_saved = 0;
-                /* restore main context using finished thread's regs as old_regs */
-                context_switch(threads[finished].regs, main_regs);
-                /* when this returns we are back in main */
-            }
-        }
-    }
+/* cooperative yield: switch to the next ready thread, or to idle if none
+   (a thread that is still runnable just keeps going) */
+void thread_yield(void) {
+    /* the watchdog's timer must not catch the scheduler mid-decision; a
+       thread switched in resumes with its own interrupt state */
+    unsigned long sie = intr_off();
+    unsigned long now = r_time();
+    thread_t *t = &threads[cur];
+    if (now - t->since > t->longest) t->longest = now - t->since;
+    /* idle may not run while threads keep yielding to each other, so due
+       sleepers and pending UART input are picked up here too */
+    if (now >= next_wake) wake_sleepers();
+    if (r_sip() & SIE_SEIE) intr_service();
+    if (t->state == THREAD_RUNNING) t->state = THREAD_READY;
+    switch_to(pick_next());
+    intr_restore(sie);
+}
+
+/* scheduler tick (idle loop): reap in batches, wake due sleepers and run
+   what is ready */
+void sched_tick(void) {
+    if (zombies >= REAP_BATCH) reap();
+    wake_sleepers();
+    thread_yield();
 }
 
 void thread_list(void) {
     uart_puts("threads:\n");
     for (int i = 0; i < MAX_THREADS; ++i) {
         if (threads[i].used) {
-            char buf[80]; int n = 0;
+            char buf[128]; int n = 0;
             const char *p = " id:";
             while (*p) buf[n++] = *p++;
             /* id */
@@ -268,17 +353,44 @@ void thread_list(void) {
             const char *st = (threads[i].state == THREAD_READY) ? "ready" :
                              (threads[i].state == THREAD_RUNNING) ? "run" :
                              (threads[i].state == THREAD_SLEEPING) ? "sleep" :
+                             (threads[i].state == THREAD_BLOCKED) ? "block" :
                              (threads[i].state == THREAD_FINISHED) ? "fin" : "?";
             while (*st) buf[n++] = *st++;
             if (threads[i].state == THREAD_SLEEPING) {
                 p = " ticks:";
                 while (*p) buf[n++] = *p++;
-                int t = threads[i].sleep_ticks;
+                unsigned long now = r_time();
+                unsigned long left = threads[i].wake_at > now ? threads[i].wake_at - now : 0;
+                int t = (int)((left + TICK_TIME - 1) / TICK_TIME);
                 char digits2[16]; int d2 = 0;
                 if (t == 0) digits2[d2++] = '0';
                 while (t) { digits2[d2++] = '0' + (t % 10); t /= 10; }
                 for (int k = d2 - 1; k >= 0; --k) buf[n++] = digits2[k];
             }
+            /* base/effective priority */
+            p = " prio:";
+            while (*p) buf[n++] = *p++;
+            for (int k = 0; k < 2; ++k) {
+                int v = k ? threads[i].eprio : threads[i].prio;
+                if (k) buf[n++] = '/';
+                if (v >= 10) buf[n++] = '0' + v / 10;
+                buf[n++] = '0' + v % 10;
+            }
+            if (threads[i].affinity != THREAD_CPU_ALL) {
+                p = " cpus:0x";
+                while (*p) buf[n++] = *p++;
+                unsigned long m = threads[i].affinity;
+                int sh = 60;
+                while (sh > 0 && !(m >> sh)) sh -= 4;
+                for (; sh >= 0; sh -= 4) buf[n++] = "0123456789abcdef"[(m >> sh) & 0xf];
+            }
+            p = " cpu-ms:";
+            while (*p) buf[n++] = *p++;
+            unsigned long ms = threads[i].cpu_time / (TIMEBASE_HZ / 1000);
+            char digits3[16]; int d3 = 0;
+            if (ms == 0) digits3[d3++] = '0';
+            while (ms && d3 < 12) { digits3[d3++] = '0' + (ms % 10); ms /= 10; }
+            for (int k = d3 - 1; k >= 0; --k) buf[n++] = digits3[k];
             buf[n++] = '\n';
             buf[n] = '\0';
             uart_puts(buf);
@@ -286,21 +398,240 @@ void thread_list(void) {
     }
 }
 
+int thread_exists(tid_t tid) {
+    int idx = find_idx_by_tid(tid);
+    return idx >= 0 && threads[idx].state != THREAD_FINISHED;
+}
+
+int thread_set_satp(tid_t tid, unsigned long satp) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0) return -1;
+    threads[idx].regs[14] = satp;
+    return 0;
+}
+
+tid_t thread_self(void) {
+    return threads[cur].id;
+}
+
+fpu_state *thread_fpu(void) {
+    return &threads[cur].fpu;
+}
+
+unsigned long thread_cputime(tid_t tid) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0) return 0;
+    unsigned long t = threads[idx].cpu_time;
+    /* include the slice in progress for the running thread */
+    if (idx == cur) t += r_time() - threads[idx].run_start;
+    return t;
+}
+
+int thread_stack_stats(thread_stack_stat *out, int max) {
+    int n = 0;
+    for (int i = 0; i < MAX_THREADS && n < max; ++i) {
+        if (!threads[i].used) continue;
+        unsigned char *lo = i == IDLE ? _stack_bottom : stacks[i];
+        unsigned char *hi = i == IDLE ? _stack_top : stacks[i] + STACK_SIZE;
+        /* stacks grow down: the lowest byte no longer painted is the peak */
+        unsigned char *p = lo;
+        while (p < hi && *p == STACK_PAINT) p++;
+        out[n].tid = threads[i].id;
+        strlcpy(out[n].name, threads[i].name, sizeof(out[n].name));
+        out[n].stack_size = (unsigned long)(hi - lo);
+        out[n].stack_peak = (unsigned long)(hi - p);
+        n++;
+    }
+    return n;
+}
+
+static void run_stat(int i, thread_run_stat *out) {
+    out->tid = threads[i].id;
+    strlcpy(out->name, threads[i].name, sizeof(out->name));
+    out->since = threads[i].since;
+    out->longest = threads[i].longest;
+}
+
+int thread_run_self(thread_run_stat *out) {
+    if (cur == IDLE) return -1;
+    run_stat(cur, out);
+    return 0;
+}
+
+int thread_run_stats(thread_run_stat *out, int max) {
+    int n = 0;
+    for (int i = 0; i < MAX_THREADS && n < max; ++i) {
+        if (i == IDLE || !threads[i].used || threads[i].state == THREAD_FINISHED) continue;
+        run_stat(i, &out[n++]);
+    }
+    return n;
+}
+
+unsigned long thread_static_bytes(void) {
+    return sizeof(threads) + sizeof(stacks);
+}
+
 void thread_sleep(int ticks) {
     if (ticks <= 0) {
         thread_yield();
         return;
     }
-    if (cur < 0 || cur >= MAX_THREADS) return;
+    thread_sleep_until(r_time() + (unsigned long)ticks * TICK_TIME);
+}
+
+void thread_sleep_until(unsigned long when) {
+    if (cur == IDLE) return;
     threads[cur].state = THREAD_SLEEPING;
-    threads[cur].sleep_ticks = ticks;
+    threads[cur].wake_at = when;
+    if (when < next_wake) {
+        next_wake = when;
+        timer_wake_at(when);
+    }
     thread_yield();
 }
 
-int thread_kill(tid_t tid) {
+/* priority inheritance: every thread runs at least at the effective
+   priority of the threads blocked waiting for it, transitively (the owner
+   may itself be waiting). Recomputed only when a wait starts or ends or a
+   priority changes, never on the switch path. */
+static void update_eprio(void) {
+    for (int i = 0; i < MAX_THREADS; ++i) threads[i].eprio = threads[i].prio;
+    for (int pass = 0; pass < MAX_THREADS; ++pass) {
+        int changed = 0;
+        for (int i = 0; i < MAX_THREADS; ++i) {
+            const thread_t *w = &threads[i];
+            if (!w->used || w->state != THREAD_BLOCKED || w->wait_owner <= 0) continue;
+            int o = find_idx_by_tid(w->wait_owner);
+            if (o >= 0 && threads[o].eprio < w->eprio) {
+                threads[o].eprio = w->eprio;
+                changed = 1;
+            }
+        }
+        if (!changed) break;
+    }
+}
+
+void thread_block(const void *chan) {
+    thread_block_on(chan, 0);
+}
+
+void thread_block_on(const void *chan, tid_t owner) {
+    if (cur == IDLE) return;
+    threads[cur].state = THREAD_BLOCKED;
+    threads[cur].wait_chan = chan;
+    threads[cur].wait_owner = owner;
+    if (owner > 0) update_eprio();
+    thread_yield();
+}
+
+/* make a blocked thread ready; returns 1 if it lent its priority */
+static int unblock(thread_t *t) {
+    int lent = t->wait_owner > 0;
+    t->state = THREAD_READY;
+    t->wait_chan = NULL;
+    t->wait_owner = 0;
+    return lent;
+}
+
+int thread_wake(const void *chan) {
+    int n = 0, lent = 0;
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (threads[i].used && threads[i].state == THREAD_BLOCKED && threads[i].wait_chan == chan) {
+            lent |= unblock(&threads[i]);
+            n++;
+        }
+    }
+    if (lent) update_eprio();
+    return n;
+}
+
+unsigned long thread_online_cpus(void) {
+    return ncpus >= (int)(8 * sizeof(unsigned long)) ? THREAD_CPU_ALL : (1UL << ncpus) - 1;
+}
+
+int thread_set_affinity(tid_t tid, unsigned long mask) {
     int idx = find_idx_by_tid(tid);
-    if (idx < 0) return -1;
+    /* a mask with no online hart would park the thread forever */
+    if (idx < 0 || idx == IDLE || !(mask & thread_online_cpus())) return -1;
+    threads[idx].affinity = mask;
+    /* off this hart: give the CPU up now, a hart in the mask picks it up */
+    if (idx == cur && !(mask & (1UL << cpu_id()))) thread_yield();
+    return 0;
+}
+
+unsigned long thread_get_affinity(tid_t tid) {
+    int idx = find_idx_by_tid(tid);
+    return idx < 0 ? 0 : threads[idx].affinity;
+}
+
+int thread_set_prio(tid_t tid, int prio) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0 || idx == IDLE || prio < THREAD_PRIO_MIN || prio > THREAD_PRIO_MAX) return -1;
+    threads[idx].prio = prio;
+    update_eprio();
+    return 0;
+}
+
+void thread_idle(void) {
+    /* with interrupts off, a handler (a ^C interrupt, a watchdog kill, the
+       samplers re-arming the timer) cannot slip in between the check and
+       the wfi; wfi still wakes on a pending interrupt, which is taken once
+       they are back on */
+    unsigned long sie = intr_off();
+    /* but only on one enabled in sie: a device interrupt taken in the
+       kernel since the last yield left SEIE masked and its byte unpolled,
+       so serve it (which unmasks SEIE) before deciding to sleep */
+    if ((r_sip() & SIE_SEIE) || !(r_sie() & SIE_SEIE)) intr_service();
+    unsigned long next = wake_sleepers();
+    if (pick_next() != IDLE) {
+        intr_restore(sie);
+        return;
+    }
+    /* nothing to run: arm the timer for the next sleeper only (no periodic
+       tick) and sleep until it or a device interrupt is pending */
+    timer_set(next);
+    wfi();
+    intr_service();
+    intr_restore(sie);
+}
+
+int thread_join(tid_t tid, int *status) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0 || idx == IDLE || idx == cur || cur == IDLE) return -1;
+    if (threads[idx].joiner && thread_exists(threads[idx].joiner)) return -1;
+    threads[idx].joiner = threads[cur].id;
+    /* waiting for a thread lends it our priority, as a mutex would */
+    while (threads[idx].state != THREAD_FINISHED) {
+        if (threads[cur].interrupted) {
+            threads[cur].interrupted = 0;
+            threads[idx].joiner = 0;
+            return -1;
+        }
+        thread_block_on(&threads[idx], tid);
+    }
+    if (status) *status = threads[idx].status;
     threads[idx].used = 0;
-    if (cur == idx) cur = -1;
+    zombies--;
+    return 0;
+}
+
+int thread_interrupt(tid_t tid) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0 || idx == IDLE) return -1;
+    threads[idx].interrupted = 1;
+    if (threads[idx].state == THREAD_BLOCKED && unblock(&threads[idx])) update_eprio();
+    return 0;
+}
+
+int thread_kill(tid_t tid) {
+    int idx = find_idx_by_tid(tid);
+    if (idx < 0 || idx == IDLE || threads[idx].state == THREAD_FINISHED) return -1;
+    if (idx == cur) thread_exit(THREAD_KILLED);
+    /* it may hold kernel state mid-update, so it exits itself the next time
+       it is switched in; sleepers and blocked threads are made ready so
+       that happens promptly */
+    threads[idx].killed = 1;
+    if (threads[idx].state == THREAD_SLEEPING) threads[idx].state = THREAD_READY;
+    if (threads[idx].state == THREAD_BLOCKED && unblock(&threads[idx])) update_eprio();
     return 0;
 }
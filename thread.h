@@ -2,28 +2,137 @@
 #define THREAD_H
 
 #include <stddef.h>
+#include "fpu.h"
 
 typedef int tid_t;
 
-/* thread function type */
-typedef void (*thread_fn)(void *);
+/* thread function type; the return value is the thread's exit status */
+typedef int (*thread_fn)(void *);
+
+/* exit status of a thread stopped by thread_kill */
+#define THREAD_KILLED (-9)
+
+/* make the calling (boot) context the idle thread, tid 0 */
+void thread_init(void);
+
+/* Priorities: higher runs first. 0..7 is the normal class, where threads
+   passed over are aged upwards so every priority makes progress; 8..15 is
+   the real-time class, strictly by priority and always ahead of normal
+   threads, so its threads must block or sleep to let others run. Equal
+   ranks share the CPU round-robin. */
+#define THREAD_PRIO_MIN 0
+#define THREAD_PRIO_DEFAULT 4
+#define THREAD_PRIO_RT 8
+#define THREAD_PRIO_MAX 15
 
 /* create a thread (returns tid, or -1 on failure) */
 tid_t thread_spawn(thread_fn fn, void *arg, const char *name);
+/* same, at the given priority */
+tid_t thread_spawn_prio(thread_fn fn, void *arg, const char *name, int prio);
+/* change a thread's base priority (returns 0 on success) */
+int thread_set_prio(tid_t tid, int prio);
+
+/* CPU affinity: bit n lets a thread run on hart n. New threads may run
+   anywhere. */
+#define THREAD_CPU_ALL (~0UL)
+/* harts currently scheduling threads */
+unsigned long thread_online_cpus(void);
+/* -1 if tid is unknown or mask has no online hart; a running thread that
+   moves off its hart yields */
+int thread_set_affinity(tid_t tid, unsigned long mask);
+/* 0 if tid is unknown */
+unsigned long thread_get_affinity(tid_t tid);
+
+/* finish the calling thread (what returning from its fn does) */
+void thread_exit(int status) __attribute__((noreturn));
+
+/* called by every exiting thread, killed ones included, on its own stack
+   before it is marked finished; it must not block */
+typedef void (*thread_exit_hook)(tid_t tid, int status);
+void thread_set_exit_hook(thread_exit_hook fn);
+
+/* block until tid finishes and collect its exit status, then free its slot.
+   -1 if tid is unknown or already being joined, or if thread_interrupt cut
+   the wait short. Finished threads nobody joins are recycled in batches,
+   after which their tid is unknown. */
+int thread_join(tid_t tid, int *status);
+/* make tid's current or next thread_join return -1; safe from interrupt
+   service (console ^C) */
+int thread_interrupt(tid_t tid);
 
 /* cooperative yield */
 void thread_yield(void);
 
-/* sleep for N scheduler ticks (cooperative) */
+/* thread_sleep unit */
+#define THREAD_TICK_MS 10
+
+/* sleep for N ticks of THREAD_TICK_MS (cooperative) */
 void thread_sleep(int ticks);
+/* sleep until rdtime reaches when */
+void thread_sleep_until(unsigned long when);
 
-/* scheduler tick (call from main loop to run threads) */
+/* block the calling thread until thread_wake(chan); callers re-check their
+   condition in a loop */
+void thread_block(const void *chan);
+/* thread_block for something owner holds: owner runs at no less than the
+   caller's effective priority until the caller is woken (inheritance) */
+void thread_block_on(const void *chan, tid_t owner);
+/* make every thread blocked on chan ready; returns how many */
+int thread_wake(const void *chan);
+
+/* idle thread, when no thread is ready: program the timer for the next
+   deadline and wfi until an interrupt arrives */
+void thread_idle(void);
+
+/* scheduler tick (idle loop): wake due sleepers, run ready threads */
 void sched_tick(void);
 
 /* list threads into uart (ps) */
 void thread_list(void);
 
-/* kill thread by id (returns 0 on success) */
+/* 1 if tid names a live (not finished) thread */
+int thread_exists(tid_t tid);
+
+/* address space a thread runs in (satp value); 0 keeps whatever space is
+   active, which is fine for kernel-only threads since the kernel mappings
+   are global */
+int thread_set_satp(tid_t tid, unsigned long satp);
+
+/* tid of the running thread, 0 for the idle thread */
+tid_t thread_self(void);
+/* FP save area of the running thread (fpu.c) */
+fpu_state *thread_fpu(void);
+
+/* rdtime ticks a thread has spent running (0 if unknown tid) */
+unsigned long thread_cputime(tid_t tid);
+
+typedef struct {
+    tid_t tid;
+    char name[16];
+    unsigned long stack_size;
+    unsigned long stack_peak; /* deepest use so far (bytes from the top) */
+} thread_stack_stat;
+/* fill out with up to max live or zombie threads, idle included; returns
+   the count */
+int thread_stack_stats(thread_stack_stat *out, int max);
+/* thread table plus stacks, all static */
+unsigned long thread_static_bytes(void);
+
+/* scheduling points (switch in, yield, sleep, block) per thread, for the
+   watchdog */
+typedef struct {
+    tid_t tid;
+    char name[16];
+    unsigned long since;   /* rdtime at its last scheduling point */
+    unsigned long longest; /* longest stretch without one, in rdtime ticks */
+} thread_run_stat;
+/* the running thread; -1 when it is idle */
+int thread_run_self(thread_run_stat *out);
+/* fill out with up to max live threads, idle excluded; returns the count */
+int thread_run_stats(thread_run_stat *out, int max);
+
+/* kill thread by id (returns 0 on success); another thread exits with
+   THREAD_KILLED the next time it is switched in */
 int thread_kill(tid_t tid);
 
 #endif
@@ -9,7 +9,7 @@
 void thread_start_run(void);
 
 void thread_trampoline(void) {
-    uart_puts("[trampoline] enter\n");
+    uart_trace("[trampoline] enter\n");
     thread_start_run();
     uart_puts("[trampoline] ERROR: thread_start_run returned\n");
     while (1) asm volatile("wfi");
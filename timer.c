@@ -0,0 +1,54 @@
+#include "timer.h"
+#include "sbi.h"
+#include "riscv.h"
+#include "uart.h"
+
+static int has_time_ext; /* else the legacy set_timer call */
+static unsigned long armed = TIMER_NEVER;
+static unsigned long periods[TIMER_SAMPLERS];
+static unsigned long due[TIMER_SAMPLERS]; /* next sample of each */
+static unsigned long wake = TIMER_NEVER;
+
+void timer_init(void) {
+    has_time_ext = sbi_probe(SBI_EXT_TIME) != 0;
+    timer_set(TIMER_NEVER);
+    w_sie(r_sie() | SIE_STIE);
+}
+
+void timer_set(unsigned long when) {
+    /* skip the SBI round trip when the same future deadline is already
+       armed (it can't have fired yet, so nothing is pending to clear) */
+    if (when == armed && when > r_time()) return;
+    armed = when;
+    if (has_time_ext) sbi_call(SBI_EXT_TIME, 0, (long)when, 0, 0);
+    else sbi_call(SBI_LEGACY_SET_TIMER, 0, (long)when, 0, 0);
+}
+
+void timer_sample_period(int which, unsigned long ticks) {
+    periods[which] = ticks;
+    due[which] = r_time() + ticks;
+}
+
+int timer_sample_due(int which) {
+    unsigned long now = r_time();
+    if (!periods[which] || now < due[which]) return 0;
+    due[which] += periods[which];
+    if (due[which] <= now) due[which] = now + periods[which]; /* fell behind */
+    return 1;
+}
+
+void timer_wake_at(unsigned long when) {
+    wake = when;
+}
+
+void timer_sample_arm(void) {
+    unsigned long now = r_time();
+    unsigned long when = wake > now ? wake : TIMER_NEVER;
+    for (int i = 0; i < TIMER_SAMPLERS; ++i) {
+        if (!periods[i]) continue;
+        /* idle had the timer: resume a period from now */
+        if (due[i] <= now) due[i] = now + periods[i];
+        if (due[i] < when) when = due[i];
+    }
+    if (when != TIMER_NEVER) timer_set(when);
+}
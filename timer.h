@@ -0,0 +1,31 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/* The supervisor timer, programmed through SBI. There is no scheduler tick:
+   the idle loop arms it for the next sleeper's deadline, and while threads
+   run it drives the samplers (watchdog, profiler) and wakes the scheduler
+   for the next sleeper. */
+
+#define TIMER_NEVER (~0UL)
+
+void timer_init(void);
+/* raise a timer interrupt at rdtime >= when (TIMER_NEVER disarms); also
+   clears a pending one */
+void timer_set(unsigned long when);
+
+enum { TIMER_WDOG, TIMER_PROF, TIMER_SAMPLERS };
+/* a sampler's period in rdtime ticks, 0 = off; each keeps its own next
+   deadline, so it samples at its own rate whatever the others use */
+void timer_sample_period(int which, unsigned long ticks);
+/* in the timer interrupt: whether which's deadline has passed, moving it
+   on by a period if so */
+int timer_sample_due(int which);
+/* the earliest sleeper's deadline (TIMER_NEVER: none), from the scheduler */
+void timer_wake_at(unsigned long when);
+/* arm for the next sample or the next sleeper while threads run, whichever
+   is first: a thread was switched in, or a sample was just taken. The
+   sleeper's deadline is what preempts a native program that never traps;
+   a kernel thread past it yields by itself. Nothing if neither is due. */
+void timer_sample_arm(void);
+
+#endif
@@ -0,0 +1,125 @@
+#include "trap.h"
+#include "prog.h"
+#include "riscv.h"
+#include "plic.h"
+#include "console.h"
+#include "timer.h"
+#include "fpu.h"
+#include "platform.h"
+#include "watchdog.h"
+#include "prof.h"
+#include "string.h"
+#include "uart.h"
+
+/* Supervisor traps: ecalls and faults from native user programs, or a
+   kernel bug. Interrupts trap in the kernel too once the watchdog has
+   turned sstatus.SIE on there (trap_kernel_intr), but only its timer is
+   handled in the kernel: device interrupts wait for the idle loop or
+   thread_yield, as they do when SIE is off. */
+
+#define SCAUSE_ILLEGAL 2
+#define SCAUSE_ECALL_U 8
+
+static int kernel_intr; /* sstatus.SIE on in kernel threads */
+
+extern void trap_vector(void);
+
+_Static_assert(sizeof(trapframe) <= TF_SIZE, "trapframe outgrew TF_SIZE");
+
+static void report(const char *who, const trapframe *tf) {
+    uart_puts(who);
+    uart_puts(" scause=");
+    uart_puthex(tf->scause);
+    uart_puts(" sepc=");
+    uart_puthex(tf->sepc);
+    uart_puts(" stval=");
+    uart_puthex(tf->stval);
+    uart_puts("\n");
+}
+
+void trap_init(void) {
+    w_sscratch(0); /* we are in the kernel */
+    w_stvec((unsigned long)trap_vector);
+}
+
+void trap_kernel_intr(void) {
+    kernel_intr = 1;
+    s_sstatus(SSTATUS_SIE);
+}
+
+int trap_kernel_intr_on(void) {
+    return kernel_intr;
+}
+
+void intr_service(void) {
+    int irq;
+    while ((irq = plic_claim()) != 0) {
+        if (irq == platform.uart_irq) console_poll();
+        plic_complete(irq);
+    }
+    /* masked if it was taken in the kernel */
+    w_sie(r_sie() | SIE_SEIE);
+}
+
+static void handle(trapframe *tf) {
+    if (tf->scause & SCAUSE_INTR) {
+        unsigned long irq = tf->scause & ~SCAUSE_INTR;
+        /* the timer stays pending until reprogrammed: for the next sample or
+           sleeper while threads run, by the idle loop for the next sleeper */
+        if (irq == IRQ_S_TIMER) {
+            timer_set(TIMER_NEVER);
+            if (thread_self() != 0) {
+                /* each sampler at its own period; re-armed before the
+                   watchdog, which may not return */
+                int prof = timer_sample_due(TIMER_PROF);
+                int wdog = timer_sample_due(TIMER_WDOG);
+                timer_sample_arm();
+                if (prof) prof_tick(tf);
+                if (wdog) wdog_tick(tf);
+            }
+        }
+        if (tf->sstatus & SSTATUS_SPP) {
+            /* the interrupted code may be in the middle of what console_poll
+               touches: leave the device masked for the next yield */
+            if (irq == IRQ_S_EXT) w_sie(r_sie() & ~SIE_SEIE);
+            return;
+        }
+        intr_service();
+        /* from U-mode this is the only point a native program gives up the
+           CPU without a syscall */
+        if (!(tf->sstatus & SSTATUS_SPP)) thread_yield();
+        return;
+    }
+    /* first FP instruction since the thread was switched in: retry it with
+       the thread's FP registers loaded */
+    if (tf->scause == SCAUSE_ILLEGAL && fpu_trap(thread_fpu(), &tf->sstatus)) return;
+    if (tf->sstatus & SSTATUS_SPP) {
+        report("[trap] kernel fault:", tf);
+        while (1) asm volatile("wfi");
+    }
+    if (tf->scause == SCAUSE_ECALL_U) {
+        tf->sepc += 4; /* resume after the ecall */
+        syscall_dispatch(tf);
+        return;
+    }
+    report("[trap] user fault:", tf);
+    prog_self_exit(-1, "fault");
+}
+
+void trap_handler(trapframe *tf) {
+    handle(tf);
+    /* sret reloads sstatus from the frame; FS must be what the scheduler
+       set for this thread, not what it was when the trap was taken */
+    tf->sstatus = (tf->sstatus & ~SSTATUS_FS) | (r_sstatus() & SSTATUS_FS);
+}
+
+void user_enter(unsigned long entry, unsigned long usp) {
+    /* trap_return parks the next user trap just above this frame, so the
+       kernel stack below the caller is reused for every trap */
+    trapframe tf __attribute__((aligned(16)));
+    memset(&tf, 0, sizeof(tf));
+    tf.sp = usp;
+    tf.sepc = entry;
+    tf.sstatus = r_sstatus() & ~(SSTATUS_SPP | SSTATUS_SPIE | SSTATUS_SIE);
+    trap_return(&tf);
+}
@@ -0,0 +1,54 @@
+#ifndef TRAP_H
+#define TRAP_H
+
+#include "thread.h"
+#include "vm.h"
+
+/* Register state saved by trap_vector (trapvec.S), x1..x31 in register
+   number order followed by the trap CSRs. Offsets are hard-coded in
+   trapvec.S; keep both in sync. */
+typedef struct {
+    unsigned long ra, sp, gp, tp;
+    unsigned long t0, t1, t2;
+    unsigned long s0, s1;
+    unsigned long a0, a1, a2, a3, a4, a5, a6, a7;
+    unsigned long s2, s3, s4, s5, s6, s7, s8, s9, s10, s11;
+    unsigned long t3, t4, t5, t6;
+    unsigned long sepc;
+    unsigned long sstatus;
+    unsigned long scause;
+    unsigned long stval;
+} trapframe;
+
+#define TF_SIZE 288 /* sizeof(trapframe) rounded up to 16 */
+
+void trap_init(void);
+/* called from trap_vector with the saved frame */
+void trap_handler(trapframe *tf);
+/* claim and handle pending device interrupts (UART rx) */
+void intr_service(void);
+/* let interrupts trap in kernel threads too (the watchdog's timer), from
+   now on; device interrupts taken there are masked until intr_service */
+void trap_kernel_intr(void);
+int trap_kernel_intr_on(void);
+/* ecall from U-mode (syscall.c); numbers are in syscall.h */
+void syscall_dispatch(trapframe *tf);
+
+/* the instance a system call runs for: the trapping thread itself, or the
+   owner of an io ring (ring.c), possibly drained by another thread */
+typedef struct {
+    tid_t tid;
+    vm_space *vs;
+    int caps;
+    int in_trap; /* 0 from a ring: quotas fail the call instead of stopping */
+} sys_caller;
+
+/* run call nr with args a0..a2 for who; ring_only limits it to the calls
+   that never block */
+long syscall_run(const sys_caller *who, unsigned long nr, const unsigned long *args, int ring_only);
+/* restore a frame and sret; for user frames, sscratch gets the kernel stack */
+void trap_return(trapframe *tf) __attribute__((noreturn));
+/* drop the current thread into U-mode at entry with the given stack */
+void user_enter(unsigned long entry, unsigned long usp) __attribute__((noreturn));
+
+#endif
@@ -1,7 +1,8 @@
 #include "uart.h"
+#include "platform.h"
 #include <stdint.h>
 
-#define UART0 0x10000000UL   // base address for UART
+#define UART0 (platform.uart.base)   // from the FDT, else QEMU virt's 0x10000000
 
 static inline void mmio_write(uintptr_t addr, uint8_t v) {
     *(volatile uint8_t*)addr = v;
@@ -34,8 +35,35 @@ void uart_puts(const char *s) {
     while (*s) uart_putc(*s++);
 }
 
+void uart_putu(unsigned long v) {
+    char digits[20];
+    int d = 0;
+    do {
+        digits[d++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (d) uart_putc(digits[--d]);
+}
+
+void uart_puti(long v) {
+    if (v < 0) uart_putc('-');
+    uart_putu(v < 0 ? 0UL - (unsigned long)v : (unsigned long)v);
+}
+
+void uart_puthex(unsigned long v) {
+    int sh = 60;
+    uart_puts("0x");
+    while (sh > 0 && !(v >> sh)) sh -= 4;
+    for (; sh >= 0; sh -= 4) uart_putc("0123456789abcdef"[(v >> sh) & 0xf]);
+}
+
 int uart_getc(void) {
     // Wait for data ready (LSR bit 0)
     while (!(mmio_read(UART0 + 5) & 1)) {}
     return (int)mmio_read(UART0 + 0);
 }
+
+void uart_rx_irq(int on) {
+    // IER bit 0 = received data available interrupt
+    mmio_write(UART0 + 1, on ? 0x01 : 0x00);
+}
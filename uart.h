@@ -1,8 +1,21 @@
 #ifndef UART_H
 #define UART_H
 #include <stdint.h>
+#include "config.h"
 void uart_putc(char c);
 void uart_puts(const char *s);
+/* numbers: decimal, signed decimal, and hex with a 0x prefix and no
+   leading zeros */
+void uart_putu(unsigned long v);
+void uart_puti(long v);
+void uart_puthex(unsigned long v);
+/* debug output compiled in only with CONFIG_TRACE */
+#if CONFIG_TRACE
+#define uart_trace(s) uart_puts(s)
+#else
+#define uart_trace(s) ((void)0)
+#endif
 int uart_getc(void);
 int uart_haschar(void);
+void uart_rx_irq(int on);
 #endif
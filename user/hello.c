@@ -0,0 +1,26 @@
+#include "ulib.h"
+
+/* hello: prints, then round-trips a file through the FS.
+   Needs CAP_UART, and CAP_FS_R|CAP_FS_W for the file part (caps 7). */
+int main(void) {
+    static const char msg[] = "hello from U-mode";
+    char back[32];
+    puts("[hello] ");
+    puts(msg);
+    puts("\n");
+    if (fs_write("hello.txt", msg, sizeof(msg)) < 0) {
+        puts("[hello] fs_write denied\n");
+        return 1;
+    }
+    long n = fs_read("hello.txt", back, sizeof(back));
+    if (n < 0) {
+        puts("[hello] fs_read denied\n");
+        return 1;
+    }
+    puts("[hello] read back ");
+    put_int(n);
+    puts(" bytes: ");
+    puts(back);
+    puts("\n");
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include "ulib.h"
+
+/* primes: CPU-bound sieve at native speed, yielding between passes so the
+   shell stays responsive. Needs CAP_UART (caps 1). */
+#define LIMIT 20000
+#define PASSES 10
+
+static unsigned char composite[LIMIT + 1];
+
+int main(void) {
+    long count = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        memset(composite, 0, sizeof(composite));
+        count = 0;
+        for (long i = 2; i <= LIMIT; ++i) {
+            if (composite[i]) continue;
+            count++;
+            for (long j = i * i; j <= LIMIT; j += i) composite[j] = 1;
+        }
+        yield();
+    }
+    puts("[primes] ");
+    put_int(count);
+    puts(" primes below ");
+    put_int(LIMIT);
+    puts(", ");
+    put_int(PASSES);
+    puts(" passes\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "ulib.h"
+#include "syscall.h"
+
+/* ringio: writes and reads back a batch of files through the io ring,
+   one trap for all the writes and one for all the reads.
+   Needs CAP_UART|CAP_FS_R|CAP_FS_W (caps 7). */
+#define FILES 8
+
+static char names[FILES][8];
+static char data[FILES][16];
+static char back[FILES][16];
+
+static void drain(struct io_ring *r, long *ok) {
+    struct io_cqe cqe;
+    while (ring_reap(r, &cqe)) {
+        if (cqe.res >= 0) (*ok)++;
+    }
+}
+
+int main(void) {
+    struct io_ring *r = ring_setup(0);
+    if (!r) {
+        puts("[ringio] ring_setup failed\n");
+        return 1;
+    }
+    for (int i = 0; i < FILES; ++i) {
+        memcpy(names[i], "ring0.t", 8);
+        names[i][4] = '0' + i;
+        memcpy(data[i], "payload #0", 11);
+        data[i][9] = '0' + i;
+        ring_submit(r, SYS_FS_WRITE, (unsigned long)names[i], (unsigned long)data[i], 11, i);
+    }
+    long traps = 0, wrote = 0, read = 0;
+    ring_enter();
+    traps++;
+    drain(r, &wrote);
+
+    for (int i = 0; i < FILES; ++i) {
+        ring_submit(r, SYS_FS_READ, (unsigned long)names[i], (unsigned long)back[i], sizeof(back[i]), i);
+    }
+    ring_submit(r, SYS_WRITE, (unsigned long)"[ringio] batch done\n", 20, 0, 99);
+    ring_enter();
+    traps++;
+    drain(r, &read);
+
+    puts("[ringio] ");
+    put_int(wrote);
+    puts(" writes, ");
+    put_int(read - 1); /* minus the console write */
+    puts(" reads in ");
+    put_int(traps);
+    puts(" traps; last file: ");
+    puts(back[FILES - 1]);
+    puts("\n");
+    return 0;
+}
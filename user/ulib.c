@@ -0,0 +1,111 @@
+#include "ulib.h"
+#include "syscall.h"
+
+static inline long syscall3(long nr, long a0, long a1, long a2) {
+    register long r_a0 asm("a0") = a0;
+    register long r_a1 asm("a1") = a1;
+    register long r_a2 asm("a2") = a2;
+    register long r_a7 asm("a7") = nr;
+    asm volatile("ecall" : "+r"(r_a0) : "r"(r_a1), "r"(r_a2), "r"(r_a7) : "memory");
+    return r_a0;
+}
+
+void exit(int code) {
+    syscall3(SYS_EXIT, code, 0, 0);
+    for (;;) { }
+}
+
+long write(const void *buf, unsigned long len) {
+    return syscall3(SYS_WRITE, (long)buf, (long)len, 0);
+}
+
+long read(void *buf, unsigned long max) {
+    return syscall3(SYS_READ, (long)buf, (long)max, 0);
+}
+
+void yield(void) {
+    syscall3(SYS_YIELD, 0, 0, 0);
+}
+
+void sleep(int ticks) {
+    syscall3(SYS_SLEEP, ticks, 0, 0);
+}
+
+long spawn(const char *app) {
+    return syscall3(SYS_SPAWN, (long)app, 0, 0);
+}
+
+long fs_read(const char *name, void *buf, unsigned long max) {
+    return syscall3(SYS_FS_READ, (long)name, (long)buf, (long)max);
+}
+
+long fs_write(const char *name, const void *buf, unsigned long len) {
+    return syscall3(SYS_FS_WRITE, (long)name, (long)buf, (long)len);
+}
+
+long fs_delete(const char *name) {
+    return syscall3(SYS_FS_DELETE, (long)name, 0, 0);
+}
+
+struct io_ring *ring_setup(unsigned long flags) {
+    long va = syscall3(SYS_RING_SETUP, (long)flags, 0, 0);
+    return va < 0 ? 0 : (struct io_ring *)va;
+}
+
+long ring_enter(void) {
+    return syscall3(SYS_RING_ENTER, 0, 0, 0);
+}
+
+int ring_submit(struct io_ring *r, unsigned long nr, unsigned long a0, unsigned long a1,
+                unsigned long a2, unsigned long user_data) {
+    unsigned int tail = r->sq_tail;
+    if (tail - __atomic_load_n(&r->sq_head, __ATOMIC_ACQUIRE) >= IORING_ENTRIES) return -1;
+    struct io_sqe *sqe = &r->sq[tail & (IORING_ENTRIES - 1)];
+    sqe->nr = nr;
+    sqe->args[0] = a0;
+    sqe->args[1] = a1;
+    sqe->args[2] = a2;
+    sqe->user_data = user_data;
+    __atomic_store_n(&r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int ring_reap(struct io_ring *r, struct io_cqe *out) {
+    unsigned int head = r->cq_head;
+    if (head == __atomic_load_n(&r->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    *out = r->cq[head & (IORING_ENTRIES - 1)];
+    __atomic_store_n(&r->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+unsigned long strlen(const char *s) {
+    unsigned long n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+void *memset(void *dst, int val, unsigned long n) {
+    unsigned char *d = (unsigned char *)dst;
+    while (n--) *d++ = (unsigned char)val;
+    return dst;
+}
+
+void *memcpy(void *dst, const void *src, unsigned long n) {
+    unsigned char *d = (unsigned char *)dst;
+    const unsigned char *s = (const unsigned char *)src;
+    while (n--) *d++ = *s++;
+    return dst;
+}
+
+void puts(const char *s) {
+    write(s, strlen(s));
+}
+
+void put_int(long v) {
+    char buf[24];
+    int n = sizeof(buf);
+    unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+    do { buf[--n] = '0' + (u % 10); u /= 10; } while (u);
+    if (v < 0) buf[--n] = '-';
+    write(buf + n, sizeof(buf) - n);
+}
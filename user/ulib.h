@@ -0,0 +1,36 @@
+#ifndef ULIB_H
+#define ULIB_H
+
+#include "ioring.h"
+
+/* User-side library for native programs: system call wrappers (numbers in
+   syscall.h) and a few string/printing helpers. Calls return a negative
+   value on failure, including when the program lacks the capability. */
+
+void exit(int code) __attribute__((noreturn));
+long write(const void *buf, unsigned long len);
+long read(void *buf, unsigned long max);
+void yield(void);
+void sleep(int ticks);
+long spawn(const char *app);
+long fs_read(const char *name, void *buf, unsigned long max);
+long fs_write(const char *name, const void *buf, unsigned long len);
+long fs_delete(const char *name);
+
+/* io ring (ioring.h): batch non-blocking calls, one trap per batch or none
+   with IORING_SQPOLL */
+struct io_ring *ring_setup(unsigned long flags); /* NULL on failure */
+long ring_enter(void);
+/* queue a call; -1 if the submission queue is full */
+int ring_submit(struct io_ring *r, unsigned long nr, unsigned long a0, unsigned long a1,
+                unsigned long a2, unsigned long user_data);
+/* take one completion into *out; 0 if none is ready */
+int ring_reap(struct io_ring *r, struct io_cqe *out);
+
+unsigned long strlen(const char *s);
+void *memset(void *dst, int val, unsigned long n);
+void *memcpy(void *dst, const void *src, unsigned long n);
+void puts(const char *s); /* no newline added */
+void put_int(long v);
+
+#endif
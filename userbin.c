@@ -0,0 +1,33 @@
+#include "userbin.h"
+#include "fs.h"
+#include "uart.h"
+
+/* symbols made by `objcopy -I binary` for each embedded user/<name>.elf */
+#define USERBIN(sym) \
+    extern const unsigned char _binary_user_##sym##_elf_start[]; \
+    extern const unsigned char _binary_user_##sym##_elf_end[];
+USERBIN(hello)
+USERBIN(primes)
+USERBIN(ringio)
+#undef USERBIN
+
+static const struct {
+    const char *file;
+    const unsigned char *start;
+    const unsigned char *end;
+} userbins[] = {
+    { "hello.elf", _binary_user_hello_elf_start, _binary_user_hello_elf_end },
+    { "primes.elf", _binary_user_primes_elf_start, _binary_user_primes_elf_end },
+    { "ringio.elf", _binary_user_ringio_elf_start, _binary_user_ringio_elf_end },
+};
+
+void userbin_install(void) {
+    for (unsigned long i = 0; i < sizeof(userbins) / sizeof(userbins[0]); ++i) {
+        int len = (int)(userbins[i].end - userbins[i].start);
+        if (fs_write_buf(userbins[i].file, userbins[i].start, len) != 0) {
+            uart_puts("[userbin] no room for ");
+            uart_puts(userbins[i].file);
+            uart_puts("\n");
+        }
+    }
+}
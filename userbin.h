@@ -0,0 +1,8 @@
+#ifndef USERBIN_H
+#define USERBIN_H
+
+/* copy the user programs linked into the kernel (user/, see Makefile) into
+   the FS so `prog loadelf` can find them */
+void userbin_install(void);
+
+#endif
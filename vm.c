@@ -0,0 +1,220 @@
+#include "vm.h"
+#include "kalloc.h"
+#include "platform.h"
+#include "riscv.h"
+#include "string.h"
+#include "uart.h"
+#include <stddef.h>
+
+#define VM_SPACES 48
+#define MEGA (2UL * 1024 * 1024)
+
+#define VPN(va, level) (((va) >> (12 + 9 * (level))) & 0x1ff)
+#define PA2PTE(pa) (((unsigned long)(pa) >> 12) << 10)
+#define PTE2PA(pte) (((pte) >> 10) << 12)
+#define PTE_LEAF (PTE_R | PTE_W | PTE_X)
+
+static pte_t *kernel_root;
+static unsigned long kernel_satp;
+static vm_space spaces[VM_SPACES];
+
+static unsigned int asid_max;        /* highest ASID the hart keeps */
+static unsigned char asid_used[256]; /* we hand out at most 255 */
+
+/* kernel megapage: identity, global, never user-accessible */
+static void kmap_mega(unsigned long pa, unsigned long flags) {
+    pte_t *l1;
+    pte_t *e2 = &kernel_root[VPN(pa, 2)];
+    if (!(*e2 & PTE_V)) {
+        l1 = (pte_t *)kalloc_page(KMEM_PGTABLE);
+        *e2 = PA2PTE(l1) | PTE_V | PTE_G;
+    } else {
+        l1 = (pte_t *)PTE2PA(*e2);
+    }
+    l1[VPN(pa, 1)] = PA2PTE(pa) | flags | PTE_V | PTE_G | PTE_A | PTE_D;
+}
+
+static void kmap_range(unsigned long start, unsigned long end, unsigned long flags) {
+    for (unsigned long pa = start & ~(MEGA - 1); pa < end; pa += MEGA) kmap_mega(pa, flags);
+}
+
+void vm_init(void) {
+    kernel_root = (pte_t *)kalloc_page(KMEM_PGTABLE);
+    /* RAM: kernel image, stacks and the page pool */
+    kmap_range(platform.ram_base, platform.ram_base + platform.ram_size, PTE_R | PTE_W | PTE_X);
+    /* MMIO found in the FDT: CLINT, PLIC, UART0 + virtio */
+    const mmio_range *dev[] = { &platform.clint, &platform.plic, &platform.uart };
+    for (int i = 0; i < 3; ++i) kmap_range(dev[i]->base, dev[i]->base + dev[i]->size, PTE_R | PTE_W);
+    for (int i = 0; i < platform.nvirtio; ++i) {
+        kmap_range(platform.virtio[i].base, platform.virtio[i].base + platform.virtio[i].size, PTE_R | PTE_W);
+    }
+
+    kernel_satp = SATP_SV39 | ((unsigned long)kernel_root >> 12);
+
+    /* probe ASID width: unimplemented ASID bits read back as zero */
+    w_satp(kernel_satp | (SATP_ASID_MASK << SATP_ASID_SHIFT));
+    asid_max = (unsigned int)((r_satp() >> SATP_ASID_SHIFT) & SATP_ASID_MASK);
+    if (asid_max > 255) asid_max = 255;
+
+    w_satp(kernel_satp);
+    sfence_vma();
+    uart_puts("[vm] sv39 on, kernel in 2M megapages\n");
+}
+
+unsigned long vm_kernel_satp(void) {
+    return kernel_satp;
+}
+
+unsigned int vm_asids(void) {
+    return asid_max;
+}
+
+static unsigned int asid_alloc(void) {
+    for (unsigned int a = 1; a <= asid_max; ++a) {
+        if (!asid_used[a]) {
+            asid_used[a] = 1;
+            /* drop anything a previous owner of this ASID left in the TLB */
+            sfence_vma_asid(a);
+            return a;
+        }
+    }
+    /* none left: ASID 0 is shared, and context_switch flushes the TLB
+       whenever it switches to a space that has it */
+    return 0;
+}
+
+vm_space *vm_space_create(void) {
+    vm_space *vs = NULL;
+    for (int i = 0; i < VM_SPACES; ++i) {
+        if (!spaces[i].used) { vs = &spaces[i]; break; }
+    }
+    if (!vs) return NULL;
+    vs->root = (pte_t *)kalloc_page(KMEM_PGTABLE);
+    if (!vs->root) return NULL;
+    vs->used = 1;
+    /* share the kernel's level-1 tables; the user slot stays empty */
+    for (int i = 0; i < 512; ++i) vs->root[i] = kernel_root[i];
+    vs->asid = asid_alloc();
+    vs->satp = SATP_SV39 | ((unsigned long)vs->asid << SATP_ASID_SHIFT) |
+               ((unsigned long)vs->root >> 12);
+    return vs;
+}
+
+/* walk to the level-0 PTE for va, allocating tables if asked */
+static pte_t *walk(vm_space *vs, unsigned long va, int alloc) {
+    pte_t *table = vs->root;
+    for (int level = 2; level > 0; --level) {
+        pte_t *e = &table[VPN(va, level)];
+        if (!(*e & PTE_V)) {
+            if (!alloc) return NULL;
+            pte_t *next = (pte_t *)kalloc_page(KMEM_PGTABLE);
+            if (!next) return NULL;
+            *e = PA2PTE(next) | PTE_V;
+        }
+        table = (pte_t *)PTE2PA(*e);
+    }
+    return &table[VPN(va, 0)];
+}
+
+int vm_map_page(vm_space *vs, unsigned long va, unsigned long pa, unsigned long flags) {
+    if (va < USER_BASE || va >= USER_TOP) return -1;
+    pte_t *e = walk(vs, va, 1);
+    if (!e) return -1;
+    *e = PA2PTE(pa) | flags | PTE_V | PTE_A | PTE_D;
+    return 0;
+}
+
+void *vm_alloc_page(vm_space *vs, unsigned long va, unsigned long flags) {
+    if (va >= USER_BASE && va < USER_TOP) {
+        /* segments sharing a page (e.g. ELF text and data) */
+        pte_t *e = walk(vs, va, 0);
+        if (e && (*e & PTE_V)) {
+            *e |= flags;
+            return (void *)PTE2PA(*e);
+        }
+    }
+    void *page = kalloc_page(KMEM_USER);
+    if (!page) return NULL;
+    if (vm_map_page(vs, va & ~(PAGE_SIZE - 1), (unsigned long)page, flags | PTE_OWNED) < 0) {
+        kfree_page(page, KMEM_USER);
+        return NULL;
+    }
+    return page;
+}
+
+unsigned long vm_translate(vm_space *vs, unsigned long va) {
+    if (va < USER_BASE || va >= USER_TOP) return 0;
+    pte_t *e = walk(vs, va, 0);
+    if (!e || !(*e & PTE_V)) return 0;
+    return PTE2PA(*e) | (va & (PAGE_SIZE - 1));
+}
+
+void vm_flush(vm_space *vs) {
+    if (vs->asid) sfence_vma_asid(vs->asid);
+    else sfence_vma();
+}
+
+/* kernel address for a user page, 0 unless mapped with PTE_U and need */
+static unsigned long user_page(vm_space *vs, unsigned long va, unsigned long need) {
+    if (va < USER_BASE || va >= USER_TOP) return 0;
+    pte_t *e = walk(vs, va, 0);
+    need |= PTE_V | PTE_U;
+    if (!e || (*e & need) != need) return 0;
+    return PTE2PA(*e);
+}
+
+int vm_copyin(vm_space *vs, void *dst, unsigned long uva, unsigned long len) {
+    unsigned char *d = (unsigned char *)dst;
+    while (len > 0) {
+        unsigned long page = user_page(vs, uva, PTE_R);
+        if (!page) return -1;
+        unsigned long off = uva & (PAGE_SIZE - 1);
+        unsigned long n = PAGE_SIZE - off;
+        if (n > len) n = len;
+        memcpy(d, (const void *)(page + off), n);
+        d += n; uva += n; len -= n;
+    }
+    return 0;
+}
+
+int vm_copyout(vm_space *vs, unsigned long uva, const void *src, unsigned long len) {
+    const unsigned char *s = (const unsigned char *)src;
+    while (len > 0) {
+        unsigned long page = user_page(vs, uva, PTE_W);
+        if (!page) return -1;
+        unsigned long off = uva & (PAGE_SIZE - 1);
+        unsigned long n = PAGE_SIZE - off;
+        if (n > len) n = len;
+        memcpy((void *)(page + off), s, n);
+        s += n; uva += n; len -= n;
+    }
+    return 0;
+}
+
+/* free the user slot's tables (and owned pages) below a table */
+static void free_table(pte_t *table, int level) {
+    for (int i = 0; i < 512; ++i) {
+        pte_t e = table[i];
+        if (!(e & PTE_V)) continue;
+        if (level > 0 && !(e & PTE_LEAF)) free_table((pte_t *)PTE2PA(e), level - 1);
+        else if (e & PTE_OWNED) kfree_page((void *)PTE2PA(e), KMEM_USER);
+    }
+    kfree_page(table, KMEM_PGTABLE);
+}
+
+void vm_space_destroy(vm_space *vs) {
+    if (!vs || !vs->used) return;
+    /* never keep running on a root we are about to free */
+    if (r_satp() == vs->satp) {
+        w_satp(kernel_satp);
+        sfence_vma();
+    }
+    pte_t e = vs->root[VPN(USER_BASE, 2)];
+    if (e & PTE_V) free_table((pte_t *)PTE2PA(e), 1);
+    kfree_page(vs->root, KMEM_PGTABLE);
+    if (vs->asid) {
+        sfence_vma_asid(vs->asid);
+        asid_used[vs->asid] = 0;
+    }
+    vs->used = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef VM_H
+#define VM_H
+
+/* Sv39 paging: the kernel is identity-mapped with 2 MiB megapages (global,
+   shared by every address space) and each program instance gets its own
+   space, tagged with an ASID, for its private user pages. */
+
+/* user mappings live in one 1 GiB slot of the root table */
+#define USER_BASE 0x40000000UL
+#define USER_TOP  0x80000000UL
+
+/* PTE bits */
+#define PTE_V (1UL << 0)
+#define PTE_R (1UL << 1)
+#define PTE_W (1UL << 2)
+#define PTE_X (1UL << 3)
+#define PTE_U (1UL << 4)
+#define PTE_G (1UL << 5)
+#define PTE_A (1UL << 6)
+#define PTE_D (1UL << 7)
+#define PTE_OWNED (1UL << 8) /* RSW: page is freed with the space */
+
+typedef unsigned long pte_t;
+
+typedef struct {
+    int used;
+    pte_t *root;
+    unsigned int asid;  /* 0 when the hart has none left: flushed on every switch */
+    unsigned long satp;
+} vm_space;
+
+void vm_init(void);
+unsigned long vm_kernel_satp(void);
+/* number of usable ASIDs (0 = every switch flushes the TLB) */
+unsigned int vm_asids(void);
+
+vm_space *vm_space_create(void);
+void vm_space_destroy(vm_space *vs);
+/* map one 4 KiB page at va (USER_BASE..USER_TOP); returns 0 or -1 */
+int vm_map_page(vm_space *vs, unsigned long va, unsigned long pa, unsigned long flags);
+/* allocate a zeroed page, map it at va and return its kernel address; a
+   page already mapped there is reused with flags added */
+void *vm_alloc_page(vm_space *vs, unsigned long va, unsigned long flags);
+/* kernel address backing va, or 0 if unmapped */
+unsigned long vm_translate(vm_space *vs, unsigned long va);
+/* after mapping into a space that may be live: drop its cached translations */
+void vm_flush(vm_space *vs);
+/* copy between kernel memory and user pages (PTE_U, readable for copyin,
+   writable for copyout); 0 or -1 */
+int vm_copyin(vm_space *vs, void *dst, unsigned long uva, unsigned long len);
+int vm_copyout(vm_space *vs, unsigned long uva, const void *src, unsigned long len);
+
+#endif
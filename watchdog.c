@@ -0,0 +1,105 @@
+#include "config.h"
+#include "watchdog.h"
+#include "thread.h"
+#include "timer.h"
+#include "riscv.h"
+#include "shell.h"
+#include "uart.h"
+#include "string.h"
+
+/* The timer samples running threads (timer_sample_period); idle has it
+   for the next sleeper instead. Samples only read the thread table, so
+   logging is safe anywhere; preempting or killing a thread that is in the
+   middle of updating shared state is not, which is why they are opt-in. */
+
+#define WDOG_SAMPLES 4 /* per limit */
+#define WDOG_ROWS CONFIG_MAX_THREADS
+
+static int mode = WDOG_OFF;
+static unsigned long limit; /* rdtime ticks */
+static unsigned long lockups;
+/* the stretch last reported, so a spinning thread is logged once */
+static tid_t last_tid;
+static unsigned long last_since;
+
+static thread_run_stat rows[WDOG_ROWS];
+
+static const char *const mode_names[] = { "off", "log", "preempt", "kill" };
+
+static unsigned long ms(unsigned long ticks) {
+    return ticks / (TIMEBASE_HZ / 1000);
+}
+
+int wdog_set(int m, int limit_ms) {
+    if (m < WDOG_OFF || m > WDOG_KILL || limit_ms <= 0) return -1;
+    mode = m;
+    limit = (unsigned long)limit_ms * (TIMEBASE_HZ / 1000);
+    timer_sample_period(TIMER_WDOG, m != WDOG_OFF ? limit / WDOG_SAMPLES : 0);
+    timer_sample_arm();
+    return 0;
+}
+
+void wdog_tick(trapframe *tf) {
+    thread_run_stat st;
+    if (mode == WDOG_OFF || thread_run_self(&st) < 0) return;
+    unsigned long now = r_time();
+    /* U-mode code is preempted by the trap anyway */
+    if (!(tf->sstatus & SSTATUS_SPP) || now - st.since < limit) return;
+    if (st.tid == last_tid && st.since == last_since) return;
+    last_tid = st.tid;
+    last_since = st.since;
+    lockups++;
+    uart_puts("\n[wdog] tid ");
+    uart_putu((unsigned long)st.tid);
+    uart_puts(" (");
+    uart_puts(st.name);
+    uart_puts(") ");
+    uart_putu(ms(now - st.since));
+    uart_puts(" ms without yielding, pc ");
+    uart_puthex(tf->sepc);
+    uart_puts(mode == WDOG_PREEMPT ? ", preempted\n" : mode == WDOG_KILL ? ", killed\n" : "\n");
+    if (mode == WDOG_PREEMPT) thread_yield();
+    else if (mode == WDOG_KILL) thread_exit(THREAD_KILLED);
+}
+
+static void wdog_report(void) {
+    uart_puts("wdog: ");
+    uart_puts(mode_names[mode]);
+    uart_puts(" limit ");
+    uart_putu(ms(limit));
+    uart_puts(" ms, lockups ");
+    uart_putu(lockups);
+    uart_puts("\nlongest run without yielding:\n");
+    int n = thread_run_stats(rows, WDOG_ROWS);
+    for (int i = 0; i < n; ++i) {
+        uart_puts("  tid ");
+        uart_putu((unsigned long)rows[i].tid);
+        uart_puts(" ");
+        uart_puts(rows[i].name);
+        uart_puts(" ");
+        uart_putu(rows[i].longest / (TIMEBASE_HZ / 1000000));
+        uart_puts(" us\n");
+    }
+}
+
+static int wdog_cmd(const char *args) {
+    char word[12], nbuf[12];
+    if (!shell_word(&args, word, sizeof(word))) {
+        wdog_report();
+        return 0;
+    }
+    int m = -1;
+    for (int i = 0; i <= WDOG_KILL; ++i) {
+        if (!strcmp(word, mode_names[i])) m = i;
+    }
+    int limit_ms = shell_word(&args, nbuf, sizeof(nbuf)) ? shell_int(nbuf) : (int)ms(limit);
+    if (wdog_set(m, limit_ms) < 0) uart_puts("wdog usage: wdog [off|log|preempt|kill] [limit-ms]\n");
+    return 0;
+}
+
+void wdog_init(void) {
+    shell_register("wdog", wdog_cmd, "wdog [off|log|preempt|kill] [limit-ms]");
+    /* stays on when the watchdog is off, which only stops the samples */
+    trap_kernel_intr();
+    wdog_set(WDOG_LOG, WDOG_LIMIT_MS);
+}
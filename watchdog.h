@@ -0,0 +1,29 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "trap.h"
+
+/* Soft-lockup watchdog. Kernel threads only give up the CPU at a yield,
+   sleep or block, so one spinning without them stalls every other thread.
+   While a thread runs, the supervisor timer samples it a few times per
+   limit; a thread past the limit without a scheduling point is reported
+   with its tid, name and interrupted pc, and optionally preempted or
+   killed from the interrupt. */
+
+enum {
+    WDOG_OFF,
+    WDOG_LOG,     /* report once per stretch */
+    WDOG_PREEMPT, /* report and yield on its behalf */
+    WDOG_KILL     /* report and end it with THREAD_KILLED */
+};
+
+#define WDOG_LIMIT_MS 100 /* default */
+
+/* register the wdog command and start in WDOG_LOG */
+void wdog_init(void);
+/* mode and limit (ms > 0); -1 if either is out of range */
+int wdog_set(int mode, int limit_ms);
+/* a timer sample of the running thread (trap.c) */
+void wdog_tick(trapframe *tf);
+
+#endif